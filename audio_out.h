@@ -0,0 +1,120 @@
+#ifndef AUDIO_OUT_H
+#define AUDIO_OUT_H
+
+/* everything main() needs from the output side: on the rp2350 this is a pwm slice fed by a dma
+ ring, and on the host it is a simulated dma consumer which drains the same ring at a virtual
+ 46875 Hz and writes the cc values to a file, so the chunk loop can be run faster than realtime */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define PWM_PIN 3
+
+/* pwm ticks at the system clock and wraps every TOP ticks, giving TOP + 1 distinct levels. by
+ default this gives one pwm period per sample at 46875 Hz. when oversampling, samples are
+ synthesized at 1 / OVERSAMPLING of the pwm rate, and interpolated up to it, which allows a
+ higher pwm carrier frequency with a smaller TOP, with the resolution recovered by noise shaping,
+ e.g. 150 MHz, TOP 200 and OVERSAMPLING 16 for a 750 kHz carrier and 46875 Hz synthesis */
+#ifndef SYS_CLOCK_HZ
+#define SYS_CLOCK_HZ 48000000U
+#endif
+
+#ifndef TOP
+#define TOP 1024U
+#endif
+
+#ifndef OVERSAMPLING
+#define OVERSAMPLING 1
+#endif
+
+/* 1 for mono on PWM_PIN, or an even number of channels in pairs on channels a and b of consecutive
+ slices, on consecutive gpios from the even pin of the slice of PWM_PIN, e.g. 2 for stereo on gpio 2
+ (left) and 3 (right), or 16 on gpio 2 to 17, which are slices 1 to 7 and then 0. each slice is fed
+ by its own dma channel from its own ring, with both of its samples of a frame written together as
+ the whole cc register in one 32-bit transfer, and all slices are started in the same cycle */
+#ifndef AUDIO_OUT_CHANNELS
+#define AUDIO_OUT_CHANNELS 1
+#endif
+
+#define SLICE_CHANNELS (1 == AUDIO_OUT_CHANNELS ? 1 : 2)
+#define AUDIO_OUT_SLICES (AUDIO_OUT_CHANNELS / SLICE_CHANNELS)
+
+/* one sample for each channel of a slice, interleaved */
+#define FRAME_BYTES (SLICE_CHANNELS * sizeof(uint16_t))
+
+/* default ring geometry, which can be overridden at build time, and also sizes the ring buffer.
+ more chunks give more cushion against jitter in the producer, while smaller chunks give lower
+ latency, e.g. 8 x 128 for about 22 ms of cushion at 2.7 ms per chunk, or 2 x 64 */
+#ifndef CHUNK_COUNT
+#define CHUNK_COUNT 2
+#endif
+
+#ifndef SAMPLES_PER_CHUNK
+#define SAMPLES_PER_CHUNK 1024
+#endif
+
+/* the dma ring wrap needs the ring of each slice to be aligned to a power of two bytes of at most
+ 32 kB, within which it is padded in chained mode. samples per chunk, and the ring length in
+ samples, count frames, i.e. one sample per channel */
+#define RING_SAMPLES (CHUNK_COUNT * SAMPLES_PER_CHUNK)
+_Static_assert(RING_SAMPLES * FRAME_BYTES <= 1U << 15, "ring size must be at most 32 kB");
+_Static_assert(1 == AUDIO_OUT_CHANNELS || (!(AUDIO_OUT_CHANNELS % 2) && AUDIO_OUT_CHANNELS <= 16),
+               "mono, or pairs of channels on up to 8 slices");
+_Static_assert(CHUNK_COUNT >= 2, "need at least two chunks");
+
+enum audio_out_mode {
+    /* one dma channel, retriggering itself after each chunk, reading the ring via the dma ring
+     wrap, which needs the ring to be a power of two in length */
+    AUDIO_OUT_RING,
+
+    /* two dma channels chained to each other, which play alternate chunks and are each re-armed
+     by the producer once they finish, so that the chunks can be any length, for low latency.
+     this needs two dma channels per slice, so all sixteen of them for eight slices */
+    AUDIO_OUT_CHAINED,
+};
+
+#ifndef AUDIO_OUT_MODE
+#define AUDIO_OUT_MODE AUDIO_OUT_RING
+#endif
+
+/* in ring mode the ring itself must be a power of two in length */
+_Static_assert(AUDIO_OUT_CHAINED == AUDIO_OUT_MODE || !(RING_SAMPLES & (RING_SAMPLES - 1)),
+               "ring size must be a power of two, except in chained mode");
+
+/* mode and ring geometry in use, chosen at boot, as passed to audio_out_init() */
+extern enum audio_out_mode audio_out_mode;
+extern size_t chunk_count, samples_per_chunk;
+
+static inline int ring_geometry_valid(const enum audio_out_mode mode, const size_t chunks, const size_t samples) {
+    /* any ring which fits within the one allocated at build time, and is a power of two in
+     length if the dma ring wrap is to be used, with a whole number of synthesized samples per chunk */
+    const size_t ring = chunks * samples;
+    return chunks >= 2 && samples && !(samples % OVERSAMPLING) && ring <= RING_SAMPLES &&
+        (AUDIO_OUT_CHAINED == mode || !(ring & (ring - 1)));
+}
+
+/* configure clocks, pwm and dma for a ring of the given geometry, but do not start the pwm yet */
+void audio_out_init(const enum audio_out_mode mode, const size_t chunks, const size_t samples);
+
+/* the first sample of the given channel within the chunk the producer should fill next, given a
+ monotonically increasing chunk index. the samples of each pair of channels on a slice are
+ interleaved, so successive samples of a channel are SLICE_CHANNELS apart */
+uint16_t * audio_out_chunk(const size_t ichunk, const size_t ichannel);
+
+/* start consuming from the first chunk, which must already be filled, on all slices at once */
+void audio_out_start(void);
+
+/* run other tasks or sleep until the consumer has finished with a chunk */
+void audio_out_wait(void);
+
+/* acknowledge any finished chunk without waiting, after the producer has resynchronized */
+void audio_out_clear(void);
+
+/* offset of the next frame the consumer will read, within the whole ring, which is the same for
+ all slices */
+size_t audio_out_position(void);
+
+/* we could do context switching here for cooperative multitasking if we wanted */
+void yield(void);
+
+#endif
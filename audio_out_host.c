@@ -0,0 +1,158 @@
+/* host simulation of the output side: instead of a dma channel feeding a pwm slice, a simulated
+ consumer drains the same chunk ring in virtual time, writing each cc value it would have sent to
+ the pwm to a file. the producer never actually waits, so the chunk loop runs as fast as the host
+ can fill chunks, which makes this usable for benchmarking, regression tests and profiling. the
+ consumer can instead be paced by the wall clock, in which case a slow producer will underrun
+
+ environment variables:
+   PWM_AUDIO_OUTPUT    path to write native-endian uint16 cc values to, or "-" for stdout,
+                       interleaved by channel beyond mono
+   PWM_AUDIO_SECONDS   virtual seconds to render before exiting, default 10
+   PWM_AUDIO_REALTIME  if nonzero, pace the consumer by the wall clock
+   PWM_AUDIO_MODE, PWM_AUDIO_CHUNKS, PWM_AUDIO_CHUNK_SAMPLES
+                       override the mode ("ring" or "chained") and ring geometry passed to
+                       audio_out_init(). the simulated consumer behaves the same in either mode */
+
+#include "audio_out.h"
+#include "profile.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* one ring per slice, as on the target */
+static uint16_t buffer[AUDIO_OUT_SLICES][SLICE_CHANNELS * RING_SAMPLES];
+
+enum audio_out_mode audio_out_mode;
+size_t chunk_count, samples_per_chunk;
+
+static FILE * output;
+static size_t chunks_consumed, chunks_acknowledged, chunks_to_consume;
+static struct timespec started, consumer_started;
+static int realtime, consumer_running;
+
+static double seconds_since(const struct timespec * then) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - then->tv_sec) + 1e-9 * (now.tv_nsec - then->tv_nsec);
+}
+
+uint32_t ticks(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+uint32_t ticks_per_second(void) {
+    return 1000000000U;
+}
+
+void yield(void) { }
+
+static size_t getenv_size(const char * name, const size_t fallback) {
+    const char * string = getenv(name);
+    return string ? strtoul(string, NULL, 10) : fallback;
+}
+
+void audio_out_init(const enum audio_out_mode mode, const size_t chunks, const size_t samples) {
+    const char * mode_string = getenv("PWM_AUDIO_MODE");
+    audio_out_mode = !mode_string ? mode : !strcmp(mode_string, "chained") ? AUDIO_OUT_CHAINED : AUDIO_OUT_RING;
+    chunk_count = getenv_size("PWM_AUDIO_CHUNKS", chunks);
+    samples_per_chunk = getenv_size("PWM_AUDIO_CHUNK_SAMPLES", samples);
+    if (!ring_geometry_valid(audio_out_mode, chunk_count, samples_per_chunk)) {
+        fprintf(stderr, "%s: invalid ring geometry %zu x %zu\n", __func__, chunk_count, samples_per_chunk);
+        exit(EXIT_FAILURE);
+    }
+
+    const char * path = getenv("PWM_AUDIO_OUTPUT");
+    if (path && !strcmp(path, "-")) output = stdout;
+    else if (path && !(output = fopen(path, "wb"))) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+
+    const char * seconds = getenv("PWM_AUDIO_SECONDS");
+    const double sample_rate = (double)SYS_CLOCK_HZ / TOP;
+    chunks_to_consume = (seconds ? strtod(seconds, NULL) : 10.0) * sample_rate / samples_per_chunk + 0.5;
+
+    realtime = getenv_size("PWM_AUDIO_REALTIME", 0);
+
+    clock_gettime(CLOCK_MONOTONIC, &started);
+}
+
+uint16_t * audio_out_chunk(const size_t ichunk, const size_t ichannel) {
+    return buffer[ichannel / SLICE_CHANNELS] + ichunk % chunk_count * samples_per_chunk * SLICE_CHANNELS + ichannel % SLICE_CHANNELS;
+}
+
+static void write_chunk(const size_t ichunk) {
+    /* gather the rings of all slices into whole frames */
+    static uint16_t frames[AUDIO_OUT_CHANNELS * RING_SAMPLES / 2];
+    for (size_t ichannel = 0; ichannel < AUDIO_OUT_CHANNELS; ichannel++) {
+        const uint16_t * const src = audio_out_chunk(ichunk, ichannel);
+        for (size_t ival = 0; ival < samples_per_chunk; ival++)
+            frames[ival * AUDIO_OUT_CHANNELS + ichannel] = src[ival * SLICE_CHANNELS];
+    }
+
+    if (fwrite(frames, AUDIO_OUT_CHANNELS * sizeof(uint16_t), samples_per_chunk, output) != samples_per_chunk) {
+        perror("fwrite");
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void consume_through(const size_t chunks) {
+    /* the simulated dma finishes reading the chunk it was on, and wraps to the next one */
+    for (; chunks_consumed < chunks; chunks_consumed++)
+        if (output) write_chunk(chunks_consumed);
+
+    if (chunks_consumed >= chunks_to_consume) {
+        const double elapsed = seconds_since(&started);
+        const double simulated = (double)chunks_consumed * samples_per_chunk * TOP / SYS_CLOCK_HZ;
+        fprintf(stderr, "rendered %.3f s in %.3f s, %.1fx realtime\n",
+                simulated, elapsed, simulated / elapsed);
+        if (output) fclose(output);
+        exit(EXIT_SUCCESS);
+    }
+}
+
+static double samples_elapsed(void) {
+    /* in realtime mode, how far the consumer has gotten since it was started */
+    return consumer_running ? seconds_since(&consumer_started) * SYS_CLOCK_HZ / TOP : 0.0;
+}
+
+void audio_out_start(void) {
+    clock_gettime(CLOCK_MONOTONIC, &consumer_started);
+    consumer_running = 1;
+}
+
+size_t audio_out_position(void) {
+    if (!realtime)
+        return chunks_consumed % chunk_count * samples_per_chunk;
+
+    const size_t samples = samples_elapsed();
+    consume_through(samples / samples_per_chunk);
+    return samples % (chunk_count * samples_per_chunk);
+}
+
+void audio_out_clear(void) {
+    if (realtime) consume_through(samples_elapsed() / samples_per_chunk);
+    chunks_acknowledged = chunks_consumed;
+}
+
+void audio_out_wait(void) {
+    if (!realtime)
+        consume_through(chunks_consumed + 1);
+    else {
+        consume_through(samples_elapsed() / samples_per_chunk);
+
+        /* if no chunk has finished since the last acknowledgement, sleep until the next one does */
+        while (chunks_consumed == chunks_acknowledged) {
+            const double seconds = ((chunks_consumed + 1) * samples_per_chunk - samples_elapsed()) * TOP / SYS_CLOCK_HZ;
+            if (seconds > 0)
+                nanosleep(&(struct timespec) { .tv_sec = (time_t)seconds, .tv_nsec = (seconds - (time_t)seconds) * 1e9 }, NULL);
+            consume_through(samples_elapsed() / samples_per_chunk);
+        }
+    }
+
+    chunks_acknowledged = chunks_consumed;
+}
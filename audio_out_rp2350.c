@@ -0,0 +1,223 @@
+#include "audio_out.h"
+#include "profile.h"
+
+#include "pico/stdio.h"
+
+#include "hardware/clocks.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "hardware/pwm.h"
+#include "hardware/dma.h"
+#include "hardware/gpio.h"
+
+/* either core type: the cortex-m33 sleeps until the dma interrupt is pending, and counts cycles
+ with the dwt, while hazard3 spins, and counts cycles with mcycle */
+#ifdef __riscv
+#include "hardware/riscv.h"
+#else
+#include "hardware/structs/m33.h"
+#endif
+
+/* each slice gets consecutive dma channels from here, one in ring mode, or two in chained mode
+ which play even and odd chunks respectively */
+#define IDMA_PWM 0
+
+/* the size in bytes of the ring of each slice, rounded up to a power of two */
+#define RING_CAPACITY (1U << (32 - __builtin_clz(FRAME_BYTES * RING_SAMPLES - 1)))
+
+/* one ring per slice, each aligned to its capacity, which also satisfies any smaller ring chosen at boot */
+__attribute((aligned(RING_CAPACITY)))
+static uint16_t buffer[AUDIO_OUT_SLICES][RING_CAPACITY / sizeof(uint16_t)];
+
+enum audio_out_mode audio_out_mode;
+size_t chunk_count, samples_per_chunk;
+
+static unsigned slice_nums[AUDIO_OUT_SLICES];
+static pwm_config config;
+
+void yield(void) {
+    /* we could do context switching here for cooperative multitasking if we wanted */
+#ifdef __riscv
+    tight_loop_contents();
+#else
+    __dsb();
+    __wfe();
+#endif
+}
+
+uint32_t ticks(void) {
+#ifdef __riscv
+    return riscv_read_csr(mcycle);
+#else
+    return m33_hw->dwt_cyccnt;
+#endif
+}
+
+uint32_t ticks_per_second(void) {
+    return clock_get_hz(clk_sys);
+}
+
+static unsigned dma_channels(void) {
+    /* per slice */
+    return AUDIO_OUT_CHAINED == audio_out_mode ? 2 : 1;
+}
+
+static uint32_t dma_channel_mask(const unsigned slices) {
+    /* the dma channels of the first so many slices */
+    return ((1U << (slices * dma_channels())) - 1) << IDMA_PWM;
+}
+
+static unsigned ring_bits(void) {
+    /* of the ring in use, rounded up to a power of two bytes, which the dma wraps its reads within */
+    return 32 - __builtin_clz(chunk_count * samples_per_chunk * FRAME_BYTES - 1);
+}
+
+static unsigned pin_of_channel(const unsigned ichannel) {
+    return 1 == AUDIO_OUT_CHANNELS ? PWM_PIN : (PWM_PIN & ~1U) + ichannel;
+}
+
+void audio_out_init(const enum audio_out_mode mode, const size_t chunks, const size_t samples) {
+    if (!ring_geometry_valid(mode, chunks, samples))
+        panic("invalid ring geometry %u x %u", (unsigned)chunks, (unsigned)samples);
+    audio_out_mode = mode;
+    chunk_count = chunks;
+    samples_per_chunk = samples;
+
+#ifndef __riscv
+    /* enable sevonpend, so that we don't need nearly-empty ISRs */
+    scb_hw->scr |= M33_SCR_SEVONPEND_BITS;
+#endif
+
+    if (48000000U == SYS_CLOCK_HZ)
+        set_sys_clock_48mhz();
+    else
+        set_sys_clock_khz(SYS_CLOCK_HZ / 1000U, true);
+
+    /* usb and/or uart, per the cmake config, for reporting */
+    stdio_init_all();
+
+    /* enable the cycle counter, for timestamping chunks */
+#ifdef __riscv
+    riscv_clear_csr(mcountinhibit, 1U);
+#else
+    m33_hw->demcr |= M33_DEMCR_TRCENA_BITS;
+    m33_hw->dwt_cyccnt = 0;
+    m33_hw->dwt_ctrl |= M33_DWT_CTRL_CYCCNTENA_BITS;
+#endif
+
+    /* beyond mono, both channels of each slice, which are adjacent pins */
+    for (unsigned ichannel = 0; ichannel < AUDIO_OUT_CHANNELS; ichannel++)
+        gpio_set_function(pin_of_channel(ichannel), GPIO_FUNC_PWM);
+    for (unsigned islice = 0; islice < AUDIO_OUT_SLICES; islice++)
+        slice_nums[islice] = pwm_gpio_to_slice_num(pin_of_channel(islice * SLICE_CHANNELS));
+
+    /* set up pwm to tick at the sys clock and wrap every TOP ticks, e.g. 46875 times per second
+     at 48 MHz, such that a level of TOP is always high */
+    config = pwm_get_default_config();
+    pwm_config_set_clkdiv_int(&config, 1);
+    pwm_config_set_wrap(&config, TOP - 1);
+
+    for (unsigned idma = 0; idma < AUDIO_OUT_SLICES * dma_channels(); idma++) {
+        const unsigned channel = IDMA_PWM + idma, islice = idma / dma_channels(), ichain = idma % dma_channels();
+        dma_channel_claim(channel);
+        dma_channel_config cfg = dma_channel_get_default_config(channel);
+        channel_config_set_dreq(&cfg, pwm_get_dreq(slice_nums[islice]));
+        channel_config_set_read_increment(&cfg, true);
+        channel_config_set_write_increment(&cfg, false);
+        channel_config_set_transfer_data_size(&cfg, 2 == SLICE_CHANNELS ? DMA_SIZE_32 : DMA_SIZE_16);
+
+        /* in chained mode each channel plays one chunk and then triggers the other of its slice,
+         while in ring mode the one channel per slice retriggers itself after every chunk, raising
+         an interrupt each time. either way reads wrap within the ring, so that in chained mode a
+         channel whose re-arm was missed plays the padding and then stale chunks, rather than
+         running off the end of the ring */
+        if (AUDIO_OUT_CHAINED == audio_out_mode)
+            channel_config_set_chain_to(&cfg, channel - ichain + !ichain);
+        channel_config_set_ring(&cfg, false, ring_bits());
+
+        /* in mono, write just the half of the cc register for the channel of PWM_PIN */
+        dma_channel_configure(channel,
+                              &cfg,
+                              (uint16_t *)((void *)&pwm_hw->slice[slice_nums[islice]].cc) + (2 == SLICE_CHANNELS ? 0 : PWM_PIN % 2),
+                              audio_out_chunk(ichain, islice * SLICE_CHANNELS),
+                              samples_per_chunk | (AUDIO_OUT_CHAINED == audio_out_mode ? 0 : 1U << 28),
+                              false);
+
+        /* enable interrupt for dma, but leave it disabled in nvic */
+        dma_channel_acknowledge_irq0(channel);
+        dma_channel_set_irq0_enabled(channel, true);
+    }
+    __dsb();
+    irq_set_enabled(DMA_IRQ_0, false);
+
+    /* silence in the padding of each ring beyond its chunks, of which there is only any in chained mode */
+    for (unsigned islice = 0; islice < AUDIO_OUT_SLICES; islice++)
+        for (size_t isample = SLICE_CHANNELS * chunk_count * samples_per_chunk; isample < (1U << ring_bits()) / sizeof(uint16_t); isample++)
+            buffer[islice][isample] = TOP / 2;
+
+    /* the first channel of each slice waits for the pwm dreq, and in chained mode the second
+     waits for the first */
+    for (unsigned islice = 0; islice < AUDIO_OUT_SLICES; islice++)
+        dma_channel_start(IDMA_PWM + islice * dma_channels());
+}
+
+uint16_t * audio_out_chunk(const size_t ichunk, const size_t ichannel) {
+    return buffer[ichannel / SLICE_CHANNELS] + ichunk % chunk_count * samples_per_chunk * SLICE_CHANNELS + ichannel % SLICE_CHANNELS;
+}
+
+void audio_out_start(void) {
+    if (pwm_hw->slice[slice_nums[0]].csr & (1U << PWM_CH0_CSR_EN_LSB))
+        return;
+
+    /* configure and zero the counters of all slices, and then enable them in the same cycle, so
+     that their dreqs, and hence all channels, stay in lockstep */
+    uint32_t mask = 0;
+    for (unsigned islice = 0; islice < AUDIO_OUT_SLICES; islice++) {
+        pwm_init(slice_nums[islice], &config, false);
+        mask |= 1U << slice_nums[islice];
+    }
+    pwm_set_mask_enabled(mask);
+}
+
+void audio_out_wait(void) {
+    /* run other tasks or low power sleep until next dma interrupt from the first slice, which all
+     other slices follow within a few cycles */
+    while (!(dma_hw->intr & dma_channel_mask(1)))
+        yield();
+
+    /* acknowledge and clear the interrupt in both dma and nvic */
+    audio_out_clear();
+}
+
+static size_t frame_offset(const unsigned channel) {
+    /* position of the given dma channel within the ring of its slice, in frames, where the padding
+     counts as the first chunk, which it stands in for after a missed re-arm */
+    const unsigned islice = (channel - IDMA_PWM) / dma_channels();
+    return ((uintptr_t)dma_hw->ch[channel].read_addr - (uintptr_t)buffer[islice]) / FRAME_BYTES % (chunk_count * samples_per_chunk);
+}
+
+static void rearm(const unsigned channel) {
+    /* the channel just finished a chunk, and will next play the one after the one the other
+     channel is now playing, so point it there without triggering it */
+    const unsigned islice = (channel - IDMA_PWM) / dma_channels();
+    dma_channel_set_read_addr(channel, audio_out_chunk(frame_offset(channel) / samples_per_chunk + 1, islice * SLICE_CHANNELS), false);
+}
+
+void audio_out_clear(void) {
+    /* only acknowledge what has finished, so that a slice whose channel finishes a few cycles
+     after the first slice's is still re-armed, by the next call */
+    const uint32_t finished = dma_hw->intr & dma_channel_mask(AUDIO_OUT_SLICES);
+    dma_hw->ints0 = finished;
+    irq_clear(DMA_IRQ_0);
+
+    if (AUDIO_OUT_CHAINED == audio_out_mode)
+        for (unsigned idma = 0; idma < AUDIO_OUT_SLICES * 2; idma++)
+            if (finished & 1U << (IDMA_PWM + idma))
+                rearm(IDMA_PWM + idma);
+}
+
+size_t audio_out_position(void) {
+    /* of the first slice, and in chained mode, whichever of its channels is currently playing a chunk */
+    const unsigned channel = AUDIO_OUT_CHAINED == audio_out_mode && dma_channel_is_busy(IDMA_PWM + 1) ? IDMA_PWM + 1 : IDMA_PWM;
+    return frame_offset(channel);
+}
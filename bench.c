@@ -0,0 +1,1103 @@
+/* host-side measurements of the signal path, run as: rp2350_pwm_audio_bench [name...], which runs
+ the named measurements, or all of them if none are named */
+
+#include "audio_out.h"
+#include "quantize.h"
+#include "interpolate.h"
+#include "oscillators.h"
+#include "fixed.h"
+#include "dds.h"
+#include "wavetable.h"
+#include "polyblep.h"
+#include "voices.h"
+#include "events.h"
+#include "envelope.h"
+#include "fm.h"
+#include "pluck.h"
+
+#include <complex.h>
+#include <stddef.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* length of the measurement records, which must be a power of two */
+#define RECORD_LENGTH 65536
+
+static const double sample_rate = (double)SYS_CLOCK_HZ / TOP / OVERSAMPLING;
+
+/* measurements which fail their checks, which make the exit status nonzero */
+static size_t failures;
+
+static double seconds_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + 1e-9 * now.tv_nsec;
+}
+
+static void fft(double complex * x, const size_t n) {
+    /* in-place iterative radix-2 decimation in time, forward transform, not normalized */
+    for (size_t i = 1, j = 0; i < n; i++) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) {
+            const double complex tmp = x[i];
+            x[i] = x[j];
+            x[j] = tmp;
+        }
+    }
+
+    for (size_t len = 2; len <= n; len <<= 1) {
+        const double complex twiddle = cexp(-2.0 * M_PI * I / len);
+        for (size_t i = 0; i < n; i += len) {
+            double complex w = 1.0;
+            for (size_t j = 0; j < len / 2; j++) {
+                const double complex u = x[i + j], v = x[i + j + len / 2] * w;
+                x[i + j] = u + v;
+                x[i + j + len / 2] = u - v;
+                w *= twiddle;
+            }
+        }
+    }
+}
+
+static void periodogram(double * power, const double * x, const size_t n) {
+    /* power of x in each of the n / 2 bins up to nyquist, via a blackman-harris windowed
+     periodogram, whose low sidelobes keep strong components from leaking into other bins */
+    double complex * const spectrum = malloc(sizeof(double complex) * n);
+    double window_power = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        const double t = 2.0 * M_PI * i / n;
+        const double w = 0.35875 - 0.48829 * cos(t) + 0.14128 * cos(2 * t) - 0.01168 * cos(3 * t);
+        spectrum[i] = x[i] * w;
+        window_power += w * w;
+    }
+    fft(spectrum, n);
+
+    power[0] = 0.0;
+    for (size_t k = 1; k < n / 2; k++)
+        power[k] = 2.0 * (creal(spectrum[k]) * creal(spectrum[k]) + cimag(spectrum[k]) * cimag(spectrum[k])) / (window_power * n);
+
+    free(spectrum);
+}
+
+static double power_in_band(const double * x, const size_t n, const double rate, const double lo, const double hi) {
+    /* mean power of x within [lo, hi) hz */
+    double * const power = malloc(sizeof(double) * n / 2);
+    periodogram(power, x, n);
+
+    double sum = 0.0;
+    for (size_t k = 1; k < n / 2; k++) {
+        const double f = k * rate / n;
+        if (f >= lo && f < hi)
+            sum += power[k];
+    }
+
+    free(power);
+    return sum;
+}
+
+static void quantizer_snr(void) {
+    /* in-band snr of a 900 Hz tone at 90% of full scale after quantization to TOP + 1 levels,
+     for each order of noise shaping, with the coefficients designed for the same band */
+    const float amplitude = 0.9f;
+    static float src[RECORD_LENGTH];
+    static uint16_t dst[RECORD_LENGTH];
+    static double error[RECORD_LENGTH];
+
+    for (size_t ival = 0; ival < RECORD_LENGTH; ival++)
+        src[ival] = amplitude * cos(2.0 * M_PI * 900.0 * ival / sample_rate);
+
+    const float bands_hz[] = { 5000.0f, 10000.0f, 15000.0f, 20000.0f };
+    const size_t bands = sizeof(bands_hz) / sizeof(bands_hz[0]);
+    double snr[sizeof(bands_hz) / sizeof(bands_hz[0])][QUANTIZER_ORDER_MAX + 1];
+    double peak[sizeof(bands_hz) / sizeof(bands_hz[0])][QUANTIZER_ORDER_MAX + 1];
+
+    for (size_t iband = 0; iband < bands; iband++)
+        for (unsigned order = 0; order <= QUANTIZER_ORDER_MAX; order++) {
+            struct quantizer q;
+            quantizer_init(&q, TOP, order, bands_hz[iband] / (sample_rate / 2.0));
+            quantize(&q, dst, 1, src, RECORD_LENGTH);
+
+            peak[iband][order] = 0.0;
+            for (size_t ival = 0; ival < RECORD_LENGTH; ival++) {
+                error[ival] = (2.0 * dst[ival] / TOP - 1.0) - src[ival];
+                if (fabs(error[ival]) > peak[iband][order]) peak[iband][order] = fabs(error[ival]);
+            }
+
+            const double noise = power_in_band(error, RECORD_LENGTH, sample_rate, 0.0, bands_hz[iband]);
+            snr[iband][order] = 10.0 * log10(amplitude * amplitude / 2.0 / noise);
+        }
+
+    /* the peak error is the headroom below full scale which the signal must leave to avoid clipping */
+    for (size_t itable = 0; itable < 2; itable++) {
+        printf(itable ? "%s: peak total error in levels, by order of noise shaping\n" :
+               "%s: in-band snr in dB, by order of noise shaping\n", __func__);
+        printf("%10s", "band");
+        for (unsigned order = 0; order <= QUANTIZER_ORDER_MAX; order++)
+            printf(" %6u", order);
+        printf("\n");
+
+        for (size_t iband = 0; iband < bands; iband++) {
+            printf("%7.0f Hz", bands_hz[iband]);
+            for (unsigned order = 0; order <= QUANTIZER_ORDER_MAX; order++)
+                printf(" %6.1f", itable ? peak[iband][order] * TOP / 2.0 : snr[iband][order]);
+            printf("\n");
+        }
+    }
+}
+
+static void oversampling(void) {
+    /* for several combinations of sys clock, TOP and oversampling which all synthesize at 46875 Hz,
+     the snr within 20 kHz of a 900 Hz tone at half of full scale after interpolation up to the
+     pwm rate and quantization, for each order of noise shaping, and the cost of doing so */
+    static const struct { unsigned sys_clock_hz, top, factor; } configs[] = {
+        { 48000000, 1024, 1 },
+        { 150000000, 400, 8 },
+        { 150000000, 200, 16 },
+        { 150000000, 100, 32 },
+    };
+    const float amplitude = 0.5f, band_hz = 20000.0f;
+
+    static float src[RECORD_LENGTH], upsampled[RECORD_LENGTH];
+    static uint16_t dst[RECORD_LENGTH];
+    static double error[RECORD_LENGTH];
+
+    const size_t configs_count = sizeof(configs) / sizeof(configs[0]);
+    double snr[sizeof(configs) / sizeof(configs[0])][QUANTIZER_ORDER_MAX + 1];
+    double peak[sizeof(configs) / sizeof(configs[0])][QUANTIZER_ORDER_MAX + 1];
+    double ns[sizeof(configs) / sizeof(configs[0])];
+
+    for (size_t iconfig = 0; iconfig < configs_count; iconfig++) {
+        const unsigned factor = configs[iconfig].factor, top = configs[iconfig].top;
+        const double pwm_rate = (double)configs[iconfig].sys_clock_hz / top;
+        const size_t count = RECORD_LENGTH / factor;
+
+        for (size_t ival = 0; ival < count; ival++)
+            src[ival] = amplitude * cos(2.0 * M_PI * 900.0 * ival / (pwm_rate / factor));
+
+        struct interpolator interpolator;
+        interpolator_init(&interpolator, factor);
+        if (factor > 1) interpolate(&interpolator, upsampled, src, count);
+        else memcpy(upsampled, src, sizeof(float) * count);
+
+        double seconds = 0.0;
+        for (unsigned order = 0; order <= QUANTIZER_ORDER_MAX; order++) {
+            struct quantizer q;
+            quantizer_init(&q, top, order, band_hz / (pwm_rate / 2.0));
+
+            /* time the whole output stage, interpolation and quantization, as it would run per chunk */
+            const double then = seconds_now();
+            if (factor > 1) interpolate(&interpolator, upsampled, src, count);
+            quantize(&q, dst, 1, upsampled, RECORD_LENGTH);
+            seconds += seconds_now() - then;
+
+            peak[iconfig][order] = 0.0;
+            for (size_t ival = 0; ival < RECORD_LENGTH; ival++) {
+                error[ival] = (2.0 * dst[ival] / top - 1.0) - upsampled[ival];
+                if (fabs(error[ival]) > peak[iconfig][order]) peak[iconfig][order] = fabs(error[ival]);
+            }
+
+            const double noise = power_in_band(error, RECORD_LENGTH, pwm_rate, 0.0, band_hz);
+            snr[iconfig][order] = 10.0 * log10(amplitude * amplitude / 2.0 / noise);
+        }
+        ns[iconfig] = seconds * 1e9 / RECORD_LENGTH / (QUANTIZER_ORDER_MAX + 1);
+    }
+
+    /* peak error is given as a fraction of full scale, as TOP differs between configurations */
+    for (size_t itable = 0; itable < 2; itable++) {
+        printf(itable ? "%s: peak total error in percent of full scale, by order of noise shaping\n" :
+               "%s: snr within 20 kHz in dB by order of noise shaping, and host ns per pwm sample\n", __func__);
+        printf("%28s", "config");
+        for (unsigned order = 0; order <= QUANTIZER_ORDER_MAX; order++)
+            printf(" %6u", order);
+        printf(itable ? "\n" : " %8s\n", "host ns");
+
+        for (size_t iconfig = 0; iconfig < configs_count; iconfig++) {
+            printf("%3u MHz, TOP %4u, %2ux, %4.0f kHz", configs[iconfig].sys_clock_hz / 1000000, configs[iconfig].top,
+                   configs[iconfig].factor, configs[iconfig].sys_clock_hz / 1e3 / configs[iconfig].top);
+            for (unsigned order = 0; order <= QUANTIZER_ORDER_MAX; order++)
+                printf(" %6.1f", itable ? 50.0 * peak[iconfig][order] : snr[iconfig][order]);
+            if (itable) printf("\n");
+            else printf(" %8.1f\n", ns[iconfig]);
+        }
+    }
+
+    /* the pwm counts at the sys clock, so the budget per pwm sample is TOP cycles, less whatever
+     synthesis needs, which gets TOP * factor cycles per synthesized sample in total */
+    printf("%s: target budget is TOP cycles per pwm sample, shared with synthesis at TOP x factor per sample\n", __func__);
+}
+
+static void dual_pwm(void) {
+    /* model of dual pwm output: the snr within 20 kHz of a 900 Hz tone at 90% of full scale, as
+     summed through resistors whose actual ratio differs from nominal by the given mismatch, when
+     splitting by the nominal ratio, and by the calibrated one, i.e. the actual ratio as measured */
+    static const float ratios[] = { 16.0f, 64.0f, 256.0f };
+    static const float mismatches[] = { 0.0f, 0.001f, 0.005f, 0.01f, 0.02f, 0.05f };
+    const size_t ratios_count = sizeof(ratios) / sizeof(ratios[0]), mismatches_count = sizeof(mismatches) / sizeof(mismatches[0]);
+    const float amplitude = 0.9f;
+
+    static float src[RECORD_LENGTH];
+    static uint16_t dst[2 * RECORD_LENGTH];
+    static double error[RECORD_LENGTH];
+
+    for (size_t ival = 0; ival < RECORD_LENGTH; ival++)
+        src[ival] = amplitude * cos(2.0 * M_PI * 900.0 * ival / sample_rate);
+
+    /* the single channel this replaces, for reference */
+    struct quantizer q;
+    quantizer_init(&q, TOP, 0, 1.0f);
+    quantize(&q, dst, 1, src, RECORD_LENGTH);
+    for (size_t ival = 0; ival < RECORD_LENGTH; ival++)
+        error[ival] = (2.0 * dst[ival] / TOP - 1.0) - src[ival];
+    printf("%s: single channel, TOP %u: snr %.1f dB\n", __func__, TOP,
+           10.0 * log10(amplitude * amplitude / 2.0 / power_in_band(error, RECORD_LENGTH, sample_rate, 0.0, 20000.0)));
+
+    for (int calibrated = 0; calibrated < 2; calibrated++) {
+        printf("%s: snr in dB by resistor ratio mismatch, split by the %s ratio\n", __func__, calibrated ? "calibrated" : "nominal");
+        printf("%14s", "ratio");
+        for (size_t imismatch = 0; imismatch < mismatches_count; imismatch++)
+            printf(" %6.1f%%", 100.0f * mismatches[imismatch]);
+        printf("\n");
+
+        for (size_t iratio = 0; iratio < ratios_count; iratio++) {
+            printf("%4.0f, %4.1f bits", ratios[iratio], log2(TOP * ratios[iratio]));
+            for (size_t imismatch = 0; imismatch < mismatches_count; imismatch++) {
+                const float actual = ratios[iratio] * (1.0f + mismatches[imismatch]);
+
+                struct dual_quantizer dq;
+                dual_quantizer_init(&dq, TOP, calibrated ? actual : ratios[iratio]);
+                dual_quantize(&dq, dst, 2, src, RECORD_LENGTH);
+
+                for (size_t ival = 0; ival < RECORD_LENGTH; ival++)
+                    error[ival] = (2.0 * (dst[2 * ival] + dst[2 * ival + 1] / (double)actual) / TOP - 1.0) - src[ival];
+
+                const double noise = power_in_band(error, RECORD_LENGTH, sample_rate, 0.0, 20000.0);
+                printf(" %7.1f", 10.0 * log10(amplitude * amplitude / 2.0 / noise));
+            }
+            printf("\n");
+        }
+    }
+}
+
+static void oscillator_bank(void) {
+    /* cost per voice per sample of the oscillator bank, which loops over voices within each sample,
+     against rendering one voice at a time over the whole chunk, for increasing numbers of voices,
+     and the most voices which would fit at the synthesis rate at the measured cost */
+    const size_t count = 1024, repeats = 256;
+    static float dst[1024], voice[1024];
+
+    printf("%s: host ns per voice per sample, and voices which fit at %.0f Hz\n", __func__, sample_rate);
+    printf("%6s %10s %12s %10s\n", "voices", "bank", "one by one", "ceiling");
+    for (size_t voices = 1; voices <= OSCILLATOR_BANK_MAX; voices *= 2) {
+        static struct oscillator_bank bank, single;
+        oscillator_bank_init(&bank, OSCILLATOR_RENORMALIZE_INTERVAL, OSCILLATOR_LANES);
+        for (size_t ivoice = 0; ivoice < voices; ivoice++)
+            oscillator_bank_add(&bank, (4 + ivoice % 16) * 900.0f / 4.0f / sample_rate, 1.0f / voices);
+
+        double then = seconds_now();
+        for (size_t irepeat = 0; irepeat < repeats; irepeat++)
+            oscillator_bank_render(&bank, dst, NULL, count);
+        const double ns_bank = (seconds_now() - then) * 1e9 / repeats / count / voices;
+
+        /* the same voices, each a bank of one, summed after rendering a whole chunk of each */
+        then = seconds_now();
+        for (size_t irepeat = 0; irepeat < repeats; irepeat++) {
+            memset(dst, 0, sizeof(dst));
+            for (size_t ivoice = 0; ivoice < voices; ivoice++) {
+                oscillator_bank_init(&single, OSCILLATOR_RENORMALIZE_INTERVAL, OSCILLATOR_LANES);
+                oscillator_bank_add(&single, (4 + ivoice % 16) * 900.0f / 4.0f / sample_rate, 1.0f / voices);
+                oscillator_bank_render(&single, voice, NULL, count);
+                for (size_t ival = 0; ival < count; ival++)
+                    dst[ival] += voice[ival];
+            }
+        }
+        const double ns_single = (seconds_now() - then) * 1e9 / repeats / count / voices;
+
+        printf("%6zu %10.2f %12.2f %10.0f\n", voices, ns_bank, ns_single, 1e9 / sample_rate / ns_bank);
+    }
+}
+
+static void renormalization(void) {
+    /* for each renormalization policy, the worst amplitude error of a phasor over ten minutes at
+     several frequencies, against the bound given in oscillators.h, and the cost per voice */
+    static const size_t intervals[] = { 1, 4, 16, 64, 256, 0 };
+    static const float frequencies[] = { 20.0f, 900.0f, 5000.0f, 15000.0f, 23000.0f };
+    const size_t intervals_count = sizeof(intervals) / sizeof(intervals[0]);
+    const size_t frequencies_count = sizeof(frequencies) / sizeof(frequencies[0]);
+    const size_t count = 1024, chunks = 600.0 * sample_rate / count;
+    static float re[1024], im[1024];
+
+    printf("%s: worst amplitude error over %.0f s, of phasors from %.0f to %.0f Hz, and host ns per voice\n",
+           __func__, (double)chunks * count / sample_rate, frequencies[0], frequencies[frequencies_count - 1]);
+    printf("%10s %12s %12s %8s\n", "interval", "error", "bound", "ns");
+    for (size_t iinterval = 0; iinterval < intervals_count; iinterval++) {
+        const size_t interval = intervals[iinterval];
+
+        float worst = 0.0f;
+        for (size_t ifrequency = 0; ifrequency < frequencies_count; ifrequency++) {
+            static struct oscillator_bank bank;
+            oscillator_bank_init(&bank, interval, 1);
+            oscillator_bank_add(&bank, frequencies[ifrequency] / sample_rate, 1.0f);
+
+            for (size_t ichunk = 0; ichunk < chunks; ichunk++) {
+                oscillator_bank_render(&bank, re, im, count);
+                for (size_t ival = 0; ival < count; ival++) {
+                    const float error = fabsf(sqrtf(re[ival] * re[ival] + im[ival] * im[ival]) - 1.0f);
+                    if (error > worst) worst = error;
+                }
+            }
+        }
+
+        /* linear drift between renormalizations, plus the rounding of the magnitude itself */
+        const float bound = (interval ? interval : count) * OSCILLATOR_DRIFT_PER_SAMPLE + 0x1p-22f;
+
+        /* cost with enough voices to keep the pipeline full */
+        static struct oscillator_bank bank;
+        oscillator_bank_init(&bank, interval, 1);
+        for (size_t ivoice = 0; ivoice < 16; ivoice++)
+            oscillator_bank_add(&bank, (4 + ivoice) * 900.0f / 4.0f / sample_rate, 1.0f / 16);
+        const double then = seconds_now();
+        for (size_t irepeat = 0; irepeat < 256; irepeat++)
+            oscillator_bank_render(&bank, re, NULL, count);
+        const double ns = (seconds_now() - then) * 1e9 / 256 / count / 16;
+
+        char label[24];
+        if (interval) snprintf(label, sizeof(label), "%zu", interval);
+        else snprintf(label, sizeof(label), "per call");
+        printf("%10s %12.3g %12.3g %8.2f%s\n", label, worst, bound, ns, worst > bound ? "  exceeds bound" : "");
+        failures += worst > bound;
+    }
+}
+
+static void lanes(void) {
+    /* a single voice split into lanes, against the same voice without, over ten seconds: the worst
+     difference from it, the worst error of each against the exact sinusoid, and the cost per sample */
+    static const size_t lanes_counts[] = { 1, 2, 4, 8 };
+    const size_t count = 1024, chunks = 10.0 * sample_rate / count;
+    const double frequency = 900.0 / sample_rate;
+    static float scalar[1024], re[1024];
+
+    printf("%s: one voice at 900 Hz over %.0f s, error against one lane and exact, and host ns per sample\n",
+           __func__, (double)chunks * count / sample_rate);
+    printf("%6s %12s %12s %8s\n", "lanes", "vs one lane", "vs exact", "ns");
+    for (size_t ilanes = 0; ilanes < sizeof(lanes_counts) / sizeof(lanes_counts[0]); ilanes++) {
+        static struct oscillator_bank reference, bank;
+        oscillator_bank_init(&reference, 1, 1);
+        oscillator_bank_add(&reference, frequency, 1.0f);
+        oscillator_bank_init(&bank, 1, lanes_counts[ilanes]);
+        oscillator_bank_add(&bank, frequency, 1.0f);
+
+        float worst_scalar = 0.0f, worst_exact = 0.0f, worst_reference = 0.0f;
+        double seconds = 0.0;
+        for (size_t ichunk = 0; ichunk < chunks; ichunk++) {
+            oscillator_bank_render(&reference, scalar, NULL, count);
+
+            const double then = seconds_now();
+            oscillator_bank_render(&bank, re, NULL, count);
+            seconds += seconds_now() - then;
+
+            for (size_t ival = 0; ival < count; ival++) {
+                /* the phase is reduced in whole cycles first, so that it stays exact in double */
+                const double cycles = fmod(frequency * (ichunk * count + ival), 1.0);
+                const float exact = -cos(2.0 * M_PI * cycles);
+                if (fabsf(re[ival] - scalar[ival]) > worst_scalar) worst_scalar = fabsf(re[ival] - scalar[ival]);
+                if (fabsf(re[ival] - exact) > worst_exact) worst_exact = fabsf(re[ival] - exact);
+                if (fabsf(scalar[ival] - exact) > worst_reference) worst_reference = fabsf(scalar[ival] - exact);
+            }
+        }
+
+        /* both drift from the exact phase by the rounding of their advances, so lanes should be no
+         more than twice as far from it as one */
+        const int exceeds = worst_exact > 2.0f * worst_reference;
+        printf("%6zu %12.3g %12.3g %8.2f%s\n", lanes_counts[ilanes], worst_scalar, worst_exact, seconds * 1e9 / chunks / count,
+               exceeds ? "  exceeds bound" : "");
+        failures += exceeds;
+    }
+}
+
+static void fixed_point(void) {
+    /* the integer-only path against the float one, for one and for sixteen voices: host ns per
+     sample of synthesis and of quantization, and the snr within 20 kHz of the levels against the
+     exact sum of the voices. the checksum of the fixed point levels is the same on any target */
+    const size_t voices_counts[] = { 1, 16 };
+    static float exact[RECORD_LENGTH], samples[RECORD_LENGTH];
+    static int32_t fixed_samples[RECORD_LENGTH];
+    static uint16_t dst[RECORD_LENGTH];
+    static double error[RECORD_LENGTH];
+
+    printf("%s: host ns per sample, and snr in dB within 20 kHz\n", __func__);
+    printf("%6s %6s %10s %10s %8s %10s\n", "voices", "path", "synthesis", "quantize", "snr", "checksum");
+    for (size_t ivoices = 0; ivoices < sizeof(voices_counts) / sizeof(voices_counts[0]); ivoices++) {
+        const size_t voices = voices_counts[ivoices];
+        const float amplitude = 0.9f / voices;
+
+        for (size_t ival = 0; ival < RECORD_LENGTH; ival++) {
+            double sum = 0.0;
+            for (size_t ivoice = 0; ivoice < voices; ivoice++) {
+                const double cycles = fmod((4 + ivoice) * 900.0 / 4.0 / sample_rate * ival, 1.0);
+                sum -= amplitude * cos(2.0 * M_PI * cycles);
+            }
+            exact[ival] = sum;
+        }
+
+        for (int fixed = 0; fixed < 2; fixed++) {
+            static struct oscillator_bank bank;
+            static struct fixed_bank fbank;
+            oscillator_bank_init(&bank, 1, 1);
+            fixed_bank_init(&fbank);
+            for (size_t ivoice = 0; ivoice < voices; ivoice++) {
+                oscillator_bank_add(&bank, (4 + ivoice) * 900.0f / 4.0f / sample_rate, amplitude);
+                fixed_bank_add(&fbank, (4 + ivoice) * 900.0f / 4.0f / sample_rate, amplitude);
+            }
+
+            double then = seconds_now();
+            if (fixed) fixed_bank_render(&fbank, fixed_samples, NULL, RECORD_LENGTH);
+            else oscillator_bank_render(&bank, samples, NULL, RECORD_LENGTH);
+            const double ns_synthesis = (seconds_now() - then) * 1e9 / RECORD_LENGTH;
+
+            struct quantizer q;
+            quantizer_init(&q, TOP, 0, 1.0f);
+            then = seconds_now();
+            if (fixed) quantize_fixed(TOP, dst, 1, fixed_samples, RECORD_LENGTH);
+            else quantize(&q, dst, 1, samples, RECORD_LENGTH);
+            const double ns_quantize = (seconds_now() - then) * 1e9 / RECORD_LENGTH;
+
+            /* fnv-1a over the levels */
+            uint32_t checksum = 2166136261U;
+            for (size_t ival = 0; ival < RECORD_LENGTH; ival++) {
+                error[ival] = (2.0 * dst[ival] / TOP - 1.0) - exact[ival];
+                checksum = (checksum ^ dst[ival]) * 16777619U;
+            }
+
+            const double noise = power_in_band(error, RECORD_LENGTH, sample_rate, 0.0, 20000.0);
+            printf("%6zu %6s %10.2f %10.2f %8.1f   %08X\n", voices, fixed ? "fixed" : "float", ns_synthesis, ns_quantize,
+                   10.0 * log10(0.9 * 0.9 / 2.0 / noise), (unsigned)checksum);
+        }
+    }
+}
+
+static void dds(void) {
+    /* the phase accumulator against the rotator, for one and for sixteen voices: host ns per
+     sample, snr within 20 kHz against the exact sum of the voices, and the error of the realized
+     frequency of the first voice, as the phase it would have drifted by after an hour */
+    const size_t voices_counts[] = { 1, 16 };
+    static float exact[RECORD_LENGTH], samples[RECORD_LENGTH];
+    static double error[RECORD_LENGTH];
+
+    printf("%s: host ns per sample, snr in dB within 20 kHz, and frequency error of the first voice\n", __func__);
+    printf("%6s %8s %8s %8s %12s %16s\n", "voices", "path", "ns", "snr", "error Hz", "cycles per hour");
+    for (size_t ivoices = 0; ivoices < sizeof(voices_counts) / sizeof(voices_counts[0]); ivoices++) {
+        const size_t voices = voices_counts[ivoices];
+        const float amplitude = 0.9f / voices;
+
+        for (size_t ival = 0; ival < RECORD_LENGTH; ival++) {
+            double sum = 0.0;
+            for (size_t ivoice = 0; ivoice < voices; ivoice++)
+                sum -= amplitude * cos(2.0 * M_PI * fmod((4 + ivoice) * 900.0 / 4.0 / sample_rate * ival, 1.0));
+            exact[ival] = sum;
+        }
+
+        for (int table = 0; table < 2; table++) {
+            static struct oscillator_bank bank;
+            static struct dds_bank dbank;
+            oscillator_bank_init(&bank, 1, 1);
+            dds_bank_init(&dbank);
+            for (size_t ivoice = 0; ivoice < voices; ivoice++) {
+                oscillator_bank_add(&bank, (4 + ivoice) * 900.0f / 4.0f / sample_rate, amplitude);
+                dds_bank_add(&dbank, (4 + ivoice) * 900.0 / 4.0 / sample_rate, amplitude);
+            }
+
+            const double then = seconds_now();
+            if (table) dds_bank_render(&dbank, samples, NULL, RECORD_LENGTH);
+            else oscillator_bank_render(&bank, samples, NULL, RECORD_LENGTH);
+            const double ns = (seconds_now() - then) * 1e9 / RECORD_LENGTH;
+
+            for (size_t ival = 0; ival < RECORD_LENGTH; ival++)
+                error[ival] = samples[ival] - exact[ival];
+            const double noise = power_in_band(error, RECORD_LENGTH, sample_rate, 0.0, 20000.0);
+
+            /* realized frequency, from the advance or the increment actually in use */
+            const double realized = table ? dbank.increment[0] * sample_rate / 4294967296.0 :
+                atan2(bank.advance_im[0], bank.advance_re[0]) * sample_rate / (2.0 * M_PI);
+            const double frequency_error = realized - 900.0;
+
+            printf("%6zu %8s %8.2f %8.1f %12.3g %16.3g\n", voices, table ? "dds" : "rotator", ns,
+                   10.0 * log10(0.9 * 0.9 / 2.0 / noise), frequency_error, frequency_error * 3600.0);
+        }
+    }
+}
+
+static void dds_interp(void) {
+    /* the dds kernel on the sio interpolators, emulated here, against the plain one, over ten
+     seconds of sixteen voices, which should be identical, and the host ns per sample of each */
+    const size_t count = 1024, chunks = 10.0 * sample_rate / count, voices = 16;
+    static float plain[1024], interp[1024];
+    static struct dds_bank plain_bank, interp_bank;
+
+    dds_bank_init(&plain_bank);
+    dds_bank_init(&interp_bank);
+    for (size_t ivoice = 0; ivoice < voices; ivoice++) {
+        dds_bank_add(&plain_bank, (4 + ivoice) * 900.0 / 4.0 / sample_rate, 0.9f / voices);
+        dds_bank_add(&interp_bank, (4 + ivoice) * 900.0 / 4.0 / sample_rate, 0.9f / voices);
+    }
+
+    size_t mismatches = 0;
+    double seconds_plain = 0.0, seconds_interp = 0.0;
+    for (size_t ichunk = 0; ichunk < chunks; ichunk++) {
+        double then = seconds_now();
+        dds_bank_render(&plain_bank, plain, NULL, count);
+        seconds_plain += seconds_now() - then;
+
+        then = seconds_now();
+        dds_bank_render_interp(&interp_bank, interp, count);
+        seconds_interp += seconds_now() - then;
+
+        mismatches += !!memcmp(plain, interp, sizeof(plain));
+    }
+
+    printf("%s: %zu voices over %.0f s, %zu of %zu chunks differ, host ns per sample %.2f plain, %.2f emulated interpolators\n",
+           __func__, voices, (double)chunks * count / sample_rate, mismatches, chunks,
+           seconds_plain * 1e9 / chunks / count, seconds_interp * 1e9 / chunks / count);
+    failures += !!mismatches;
+}
+
+static double aliases_db(const float * samples, const size_t bin) {
+    /* for a periodic waveform whose fundamental is on the given exact bin, so that its harmonics
+     land on bins, the power of everything else within 20 kHz, which is aliasing, relative to the
+     harmonics, counting the main lobe of the window, four bins either side, as harmonic */
+    static double x[RECORD_LENGTH], power[RECORD_LENGTH / 2];
+    for (size_t ival = 0; ival < RECORD_LENGTH; ival++)
+        x[ival] = samples[ival];
+    periodogram(power, x, RECORD_LENGTH);
+
+    double harmonics = 0.0, aliases = 0.0;
+    for (size_t k = 1; k < RECORD_LENGTH / 2 && k * sample_rate / RECORD_LENGTH < 20000.0; k++) {
+        const size_t offset = k % bin;
+        if (offset <= 4 || offset >= bin - 4) harmonics += power[k];
+        else aliases += power[k];
+    }
+    return 10.0 * log10(aliases / harmonics);
+}
+
+static void naive_waveform(float * dst, const enum waveform waveform, const double frequency, const double width) {
+    /* evaluated from the phase at each sample, with no regard to aliasing */
+    for (size_t ival = 0; ival < RECORD_LENGTH; ival++) {
+        const double phase = fmod(frequency * ival, 1.0);
+        dst[ival] = 0.9 * (WAVEFORM_SAW == waveform ? 2.0 * phase - 1.0 :
+                           WAVEFORM_SQUARE == waveform ? (phase < width ? 1.0 : -1.0) :
+                           1.0 - 4.0 * fabs(phase - 0.5));
+    }
+}
+
+static const double waveform_fundamentals_hz[] = { 110.0, 440.0, 1760.0, 3520.0, 7040.0 };
+
+static void wavetable(void) {
+    /* each waveform from the wavetables against the naive one, at fundamentals on exact bins: host
+     ns per sample, and the power of the aliases relative to the harmonics */
+    const enum waveform waveforms[] = { WAVEFORM_SAW, WAVEFORM_SQUARE, WAVEFORM_TRIANGLE };
+    const char * const names[] = { "saw", "square", "triangle" };
+    static struct wavetable table;
+    static float samples[RECORD_LENGTH];
+
+    printf("%s: %zu bytes per waveform in %d tables, host ns per sample, and aliases relative to harmonics within 20 kHz\n",
+           __func__, wavetable_footprint(), WAVETABLE_OCTAVES);
+    printf("%9s %10s %6s %8s %10s %10s\n", "waveform", "Hz", "octave", "ns", "table dB", "naive dB");
+    for (size_t iwaveform = 0; iwaveform < sizeof(waveforms) / sizeof(waveforms[0]); iwaveform++) {
+        wavetable_init(&table, waveform_harmonic(waveforms[iwaveform]));
+
+        for (size_t ifundamental = 0; ifundamental < sizeof(waveform_fundamentals_hz) / sizeof(waveform_fundamentals_hz[0]); ifundamental++) {
+            const size_t bin = lround(waveform_fundamentals_hz[ifundamental] * RECORD_LENGTH / sample_rate);
+            const double frequency = (double)bin / RECORD_LENGTH;
+
+            static struct wavetable_bank bank;
+            wavetable_bank_init(&bank, &table);
+            wavetable_bank_add(&bank, frequency, 0.9f);
+
+            const double then = seconds_now();
+            wavetable_bank_render(&bank, samples, RECORD_LENGTH);
+            const double ns = (seconds_now() - then) * 1e9 / RECORD_LENGTH;
+            const double table_db = aliases_db(samples, bin);
+
+            naive_waveform(samples, waveforms[iwaveform], frequency, 0.5);
+            printf("%9s %10.1f %6u %8.2f %10.1f %10.1f\n", names[iwaveform], bin * sample_rate / RECORD_LENGTH,
+                   wavetable_octave(llround(frequency * 4294967296.0)), ns, table_db, aliases_db(samples, bin));
+        }
+    }
+}
+
+static void polyblep(void) {
+    /* as for the wavetables, with a pulse of a quarter of a cycle as well as a square, and the
+     bytes of state per voice, which is all the memory polyblep needs, and the mean of each as a
+     fraction of its amplitude, which should be 0 */
+    const enum waveform waveforms[] = { WAVEFORM_SAW, WAVEFORM_SQUARE, WAVEFORM_SQUARE, WAVEFORM_TRIANGLE };
+    const float widths[] = { 0.5f, 0.5f, 0.25f, 0.5f };
+    const char * const names[] = { "saw", "square", "pulse 25%", "triangle" };
+    static float samples[RECORD_LENGTH];
+
+    printf("%s: %zu bytes per voice, host ns per sample, and aliases relative to harmonics within 20 kHz\n", __func__,
+           (sizeof(struct polyblep_bank) - offsetof(struct polyblep_bank, phase)) / POLYBLEP_BANK_MAX);
+    printf("%9s %10s %8s %12s %10s %10s\n", "waveform", "Hz", "ns", "polyblep dB", "naive dB", "mean");
+    for (size_t iwaveform = 0; iwaveform < sizeof(waveforms) / sizeof(waveforms[0]); iwaveform++)
+        for (size_t ifundamental = 0; ifundamental < sizeof(waveform_fundamentals_hz) / sizeof(waveform_fundamentals_hz[0]); ifundamental++) {
+            const size_t bin = lround(waveform_fundamentals_hz[ifundamental] * RECORD_LENGTH / sample_rate);
+            const double frequency = (double)bin / RECORD_LENGTH;
+
+            static struct polyblep_bank bank;
+            polyblep_bank_init(&bank, waveforms[iwaveform]);
+            polyblep_set_width(&bank, polyblep_bank_add(&bank, frequency, 0.9f), widths[iwaveform]);
+
+            const double then = seconds_now();
+            polyblep_bank_render(&bank, samples, RECORD_LENGTH);
+            const double ns = (seconds_now() - then) * 1e9 / RECORD_LENGTH;
+            const double polyblep_db = aliases_db(samples, bin);
+
+            /* over whole cycles, as the fundamental is on a bin */
+            double sum = 0.0;
+            for (size_t ival = 0; ival < RECORD_LENGTH; ival++)
+                sum += samples[ival];
+            const double mean = sum / RECORD_LENGTH / 0.9;
+            const int exceeds = fabs(mean) > 1e-3;
+
+            naive_waveform(samples, waveforms[iwaveform], frequency, widths[iwaveform]);
+            printf("%9s %10.1f %8.2f %12.1f %10.1f %10.2g%s\n", names[iwaveform], bin * sample_rate / RECORD_LENGTH, ns,
+                   polyblep_db, aliases_db(samples, bin), mean, exceeds ? "  exceeds bound" : "");
+            failures += exceeds;
+        }
+}
+
+static void glide(void) {
+    /* one voice ramped linearly from 900 Hz at half scale to 1800 Hz at 0.9 over 4096 samples,
+     from 1000 samples in, rendered in chunks of 1024, against the exact sum of the per-sample
+     advances, which is what the ramp promises: the worst error, for one and four lanes. then an
+     exponential glide of the same, and its error from the target after it has been snapped to
+     it. and the host ns per sample of sixteen voices while ramping and while not */
+    const size_t start = 1000, length = 4096, chunk = 1024;
+    const double f0 = 900.0 / sample_rate, f1 = 1800.0 / sample_rate;
+    static float samples[RECORD_LENGTH];
+
+    printf("%s: worst error of a ramp against the exact one, and host ns per sample of 16 voices\n", __func__);
+    for (size_t lanes = 1; lanes <= 4; lanes *= 4) {
+        static struct oscillator_bank bank;
+        oscillator_bank_init(&bank, 1, lanes);
+        oscillator_bank_add(&bank, f0, 0.5f);
+
+        for (size_t ival = 0; ival < RECORD_LENGTH; ival += chunk) {
+            if (ival == start / chunk * chunk) {
+                oscillator_bank_render(&bank, samples + ival, NULL, start - ival);
+                oscillator_bank_retune(&bank, 0, f1, 0.9f, length, OSCILLATOR_RAMP);
+                oscillator_bank_render(&bank, samples + start, NULL, ival + chunk - start);
+            }
+            else oscillator_bank_render(&bank, samples + ival, NULL, chunk);
+        }
+
+        double phase = 0.5, worst = 0.0;
+        for (size_t ival = 0; ival < RECORD_LENGTH; ival++) {
+            const size_t k = ival > start ? ival - start : 0;
+            const double amplitude = k < length ? 0.5 + 0.4 * k / length : 0.9;
+            const double error = fabs(samples[ival] - amplitude * cos(2.0 * M_PI * phase));
+            if (error > worst) worst = error;
+
+            /* the advance into the next sample */
+            phase = fmod(phase + (ival < start ? f0 : k + 1 <= length ? f0 + (f1 - f0) * (k + 1) / length : f1), 1.0);
+        }
+        /* from the phase within segments, which the advance only makes exact at their ends */
+        printf("ramp, %zu lanes: worst error %.3g%s\n", lanes, worst, worst > 0.005 ? "  exceeds bound" : "");
+        failures += worst > 0.005;
+    }
+
+    static struct oscillator_bank bank;
+    oscillator_bank_init(&bank, 1, 1);
+    oscillator_bank_add(&bank, f0, 0.5f);
+    oscillator_bank_retune(&bank, 0, f1, 0.9f, length / 8, OSCILLATOR_GLIDE);
+    for (size_t ival = 0; ival < 4 * length; ival += chunk)
+        oscillator_bank_render(&bank, samples, NULL, chunk);
+    const int landed = !bank.gliding && fabs(bank.frequency[0] * sample_rate - 1800.0) < 0.01 && fabsf(bank.amplitude[0] - 0.9f) < 1e-6f;
+    printf("glide: %zu voices gliding after %zu time constants, frequency %.6f Hz, amplitude %.6f%s\n", bank.gliding,
+           4 * length / (length / 8), bank.frequency[0] * sample_rate, bank.amplitude[0], landed ? "" : "  missed the targets");
+    failures += !landed;
+
+    for (int ramp = 0; ramp < 2; ramp++) {
+        oscillator_bank_init(&bank, 1, 1);
+        for (size_t ivoice = 0; ivoice < 16; ivoice++)
+            oscillator_bank_add(&bank, (4 + ivoice) * 900.0f / 4.0f / sample_rate, 0.9f / 16);
+        if (ramp)
+            for (size_t ivoice = 0; ivoice < 16; ivoice++)
+                oscillator_bank_retune(&bank, ivoice, (4 + ivoice) * 1800.0f / 4.0f / sample_rate, 0.5f / 16, RECORD_LENGTH, OSCILLATOR_RAMP);
+
+        const double then = seconds_now();
+        for (size_t ival = 0; ival < RECORD_LENGTH; ival += chunk)
+            oscillator_bank_render(&bank, samples + ival, NULL, chunk);
+        printf("%s: %.2f ns per sample\n", ramp ? "ramping" : "steady", (seconds_now() - then) * 1e9 / RECORD_LENGTH);
+    }
+}
+
+static void events(void) {
+    /* notes switched on at once at awkward times, rendered in chunks of 1024 split at the events,
+     which should each be first heard exactly on their own sample. and the host ns per sample of
+     sixteen voices with 0 to 64 events per chunk, each of which splits a sub-block */
+    const size_t chunk = 1024, voices = 16;
+    const uint64_t times[] = { 1, 1023, 2048, 5000, 12345 };
+    static float samples[RECORD_LENGTH];
+    static struct oscillator_bank bank;
+    static struct voice_pool pool;
+    static struct event_queue queue;
+
+    oscillator_bank_init(&bank, 1, 1);
+    oscillator_bank_add(&bank, 900.0f / sample_rate, 0.0f);
+    voice_pool_init(&pool, &bank, VOICE_STEAL_OLDEST);
+    event_queue_init(&queue);
+    for (size_t itime = 0; itime < sizeof(times) / sizeof(times[0]); itime++) {
+        const struct event on = { .time = times[itime], .type = EVENT_NOTE_ON, .note = itime, .frequency = 900.0f / sample_rate, .amplitude = 0.9f };
+        const struct event off = { .time = times[itime] + 100, .type = EVENT_NOTE_OFF, .note = itime };
+        event_post(&queue, &on);
+        event_post(&queue, &off);
+    }
+
+    for (size_t ichunk = 0; ichunk < RECORD_LENGTH / chunk; ichunk++)
+        for (size_t ival = 0, count; ival < chunk; ival += count) {
+            count = event_dispatch(&queue, &pool, ichunk * chunk + ival, chunk - ival);
+            oscillator_bank_render(&bank, samples + ichunk * chunk + ival, NULL, count);
+        }
+
+    printf("%s: notes due at", __func__);
+    for (size_t itime = 0; itime < sizeof(times) / sizeof(times[0]); itime++)
+        printf(" %llu", (unsigned long long)times[itime]);
+    printf(", first heard at");
+    size_t heard = 0, on_time = 0;
+    for (size_t ival = 1; ival < RECORD_LENGTH; ival++)
+        if (samples[ival] && !samples[ival - 1]) {
+            printf(" %zu", ival);
+            on_time += heard < sizeof(times) / sizeof(times[0]) && ival == times[heard];
+            heard++;
+        }
+    const int missed = heard != sizeof(times) / sizeof(times[0]) || on_time != heard;
+    printf("%s\n", missed ? "  not as due" : "");
+    failures += missed;
+
+    for (size_t per_chunk = 0; per_chunk <= 64; per_chunk = per_chunk ? per_chunk * 4 : 1) {
+        oscillator_bank_init(&bank, 1, 1);
+        for (size_t ivoice = 0; ivoice < voices; ivoice++)
+            oscillator_bank_add(&bank, (4 + ivoice) * 900.0f / 4.0f / sample_rate, 0.0f);
+        voice_pool_init(&pool, &bank, VOICE_STEAL_OLDEST);
+        for (size_t ivoice = 0; ivoice < voices; ivoice++)
+            voice_note_on(&pool, ivoice, (4 + ivoice) * 900.0f / 4.0f / sample_rate, 0.9f / voices, 0);
+
+        double seconds = 0.0;
+        for (size_t ichunk = 0; ichunk < RECORD_LENGTH / chunk; ichunk++) {
+            for (size_t ievent = 0; ievent < per_chunk; ievent++) {
+                const size_t ivoice = ievent % voices;
+                const struct event set = { .time = ichunk * chunk + (ievent * 997 + 13) % chunk, .type = EVENT_SET, .note = ivoice,
+                    .frequency = (4 + ivoice) * 900.0f / 4.0f / sample_rate, .amplitude = 0.9f / voices };
+                event_post(&queue, &set);
+            }
+
+            const double then = seconds_now();
+            for (size_t ival = 0, count; ival < chunk; ival += count) {
+                count = event_dispatch(&queue, &pool, ichunk * chunk + ival, chunk - ival);
+                oscillator_bank_render(&bank, samples + ichunk * chunk + ival, NULL, count);
+            }
+            seconds += seconds_now() - then;
+        }
+        printf("%zu voices, %2zu events per chunk: %.2f ns per sample\n", voices, per_chunk, seconds * 1e9 / RECORD_LENGTH);
+    }
+}
+
+static void voices(void) {
+    /* which voice is stolen: four voices playing notes 0 to 3, loudest first, with note 1
+     released, so note 4 should take its voice either way, and then note 5 that of note 0 if
+     stealing the oldest, or of note 3 if the quietest. then the worst and mean host time per
+     chunk of 1024 at full polyphony, with every voice held and a note on and off every 64 samples,
+     each stealing a voice, against the same with no events */
+    const size_t chunk = 1024;
+    const char * const names[] = { "oldest", "quietest" };
+    static float samples[1024];
+    static struct oscillator_bank bank;
+    static struct voice_pool pool;
+    static struct event_queue queue;
+
+    for (int steal = VOICE_STEAL_OLDEST; steal <= VOICE_STEAL_QUIETEST; steal++) {
+        oscillator_bank_init(&bank, 1, 1);
+        for (size_t ivoice = 0; ivoice < 4; ivoice++)
+            oscillator_bank_add(&bank, 0.01f, 0.0f);
+        voice_pool_init(&pool, &bank, steal);
+
+        for (uint32_t note = 0; note < 4; note++)
+            voice_note_on(&pool, note, 0.01f * (note + 1), 0.4f - 0.1f * note, 0);
+        voice_note_off(&pool, 1, 1000);
+        const size_t voice_4 = voice_note_on(&pool, 4, 0.05f, 0.1f, 0), voice_5 = voice_note_on(&pool, 5, 0.06f, 0.1f, 0);
+        const int stolen = 1 == voice_4 && voice_5 == (VOICE_STEAL_OLDEST == steal ? 0 : 3);
+        printf("%s: stealing the %s, note 4 took the voice of note 1: %s, note 5 took that of note %d%s\n", __func__, names[steal],
+               1 == voice_4 ? "yes" : "no", 0 == voice_5 ? 0 : 3 == voice_5 ? 3 : -1, stolen ? "" : "  stole the wrong voice");
+        failures += !stolen;
+    }
+
+    /* each run does the same work, so the least time of any run for each chunk is its cost without
+     the preemption of the host, and the worst of those is the worst case */
+    static double seconds[256];
+    const size_t chunks = sizeof(seconds) / sizeof(seconds[0]), runs = 5;
+
+    for (int steal = VOICE_STEAL_OLDEST; steal <= VOICE_STEAL_QUIETEST; steal++)
+        for (int busy = 0; busy < 2; busy++) {
+            for (size_t irun = 0; irun < runs; irun++) {
+                oscillator_bank_init(&bank, 1, 1);
+                for (size_t ivoice = 0; ivoice < OSCILLATOR_BANK_MAX; ivoice++)
+                    oscillator_bank_add(&bank, 0.01f, 0.0f);
+                voice_pool_init(&pool, &bank, steal);
+                for (uint32_t note = 0; note < OSCILLATOR_BANK_MAX; note++)
+                    voice_note_on(&pool, note, (4 + note % 16) * 900.0f / 4.0f / sample_rate, 0.9f / OSCILLATOR_BANK_MAX, 0);
+                event_queue_init(&queue);
+
+                uint32_t next_note = OSCILLATOR_BANK_MAX;
+                for (size_t ichunk = 0; ichunk < chunks; ichunk++) {
+                    for (size_t ival = 0; busy && ival < chunk; ival += 64) {
+                        const struct event on = { .time = ichunk * chunk + ival, .type = EVENT_NOTE_ON, .note = next_note,
+                            .frequency = (4 + next_note % 16) * 900.0f / 4.0f / sample_rate, .amplitude = 0.9f / OSCILLATOR_BANK_MAX,
+                            .samples = 96 };
+                        const struct event off = { .time = ichunk * chunk + ival + 32, .type = EVENT_NOTE_OFF, .note = next_note - 64,
+                            .samples = 2400 };
+                        event_post(&queue, &on);
+                        event_post(&queue, &off);
+                        next_note++;
+                    }
+
+                    const double then = seconds_now();
+                    for (size_t ival = 0, count; ival < chunk; ival += count) {
+                        count = event_dispatch(&queue, &pool, ichunk * chunk + ival, chunk - ival);
+                        oscillator_bank_render(&bank, samples + ival, NULL, count);
+                    }
+                    const double elapsed = seconds_now() - then;
+                    if (!irun || elapsed < seconds[ichunk]) seconds[ichunk] = elapsed;
+                }
+            }
+
+            double worst = 0.0, sum = 0.0;
+            for (size_t ichunk = 0; ichunk < chunks; ichunk++) {
+                if (seconds[ichunk] > worst) worst = seconds[ichunk];
+                sum += seconds[ichunk];
+            }
+            printf("%s: %d voices, stealing the %s, %s: worst %.1f us per chunk, mean %.1f us, %zu sounding\n", __func__,
+                   OSCILLATOR_BANK_MAX, names[steal], busy ? "32 notes per chunk" : "no events", worst * 1e6, sum * 1e6 / chunks,
+                   voice_pool_sounding(&pool));
+        }
+}
+
+static double envelope_exact(const struct envelope * envelope, const double peak, const size_t k, const size_t held) {
+    /* the amplitude k samples after the attack, of a note held for held samples, from the
+     recurrence with exact coefficients */
+    const double sustain = peak * envelope->sustain;
+    const int linear = ENVELOPE_LINEAR == envelope->shape;
+    if (k >= held) {
+        const double from = envelope_exact(envelope, peak, held, held * 2 + 1);
+        const size_t j = k - held;
+        if (j >= envelope->release) return 0.0;
+        return linear ? from * (1.0 - (double)j / envelope->release) : from * pow(envelope->release_factor, j);
+    }
+    if (k < envelope->attack) return peak * k / envelope->attack;
+    const size_t j = k - envelope->attack;
+    if (j >= envelope->decay) return sustain;
+    return linear ? peak + (sustain - peak) * j / envelope->decay : sustain + (peak - sustain) * pow(envelope->decay_factor, j);
+}
+
+static void envelopes(void) {
+    /* the amplitude of one voice, read every 8 samples, with a note on at 1000 samples and off at
+     10000, against the exact envelope, snapped to its targets like the real one: the worst error,
+     and whether the voice is idle after its release. then the host ns per sample of sixteen voices
+     without an envelope, sustaining, and all in a decay which lasts the whole record */
+    const size_t start = 1000, held = 9000, step = 8;
+    const char * const names[] = { "linear", "exponential" };
+    static float samples[RECORD_LENGTH];
+    static struct oscillator_bank bank;
+    static struct envelope envelope;
+
+    printf("%s: worst error of the amplitude against the exact envelope, and host ns per sample of 16 voices\n", __func__);
+    for (int shape = ENVELOPE_LINEAR; shape <= ENVELOPE_EXPONENTIAL; shape++) {
+        envelope_init(&envelope, 240, 2400, 0.5f, 4800, shape);
+        oscillator_bank_init(&bank, 1, 1);
+        oscillator_bank_add(&bank, 900.0f / sample_rate, 0.0f);
+        oscillator_bank_envelope(&bank, &envelope);
+
+        double worst = 0.0;
+        for (size_t ival = 0; ival < RECORD_LENGTH; ival += step) {
+            if (start == ival) oscillator_bank_attack(&bank, 0, 0.9f);
+            if (start + held == ival) oscillator_bank_release(&bank, 0);
+            oscillator_bank_render(&bank, samples + ival, NULL, step);
+
+            const double exact = ival + step > start ? envelope_exact(&envelope, 0.9, ival + step - start, held) : 0.0;
+            const double error = fabs(bank.amplitude[0] - exact);
+            if (error > worst) worst = error;
+        }
+        const int exceeds = worst > 2e-5 || ENVELOPE_IDLE != bank.stage[0];
+        printf("%s: worst error %.3g, idle at the end: %s%s\n", names[shape], worst, ENVELOPE_IDLE == bank.stage[0] ? "yes" : "no",
+               exceeds ? "  off the envelope" : "");
+        failures += exceeds;
+    }
+
+    for (int mode = 0; mode < 3; mode++) {
+        envelope_init(&envelope, 0, 1 == mode ? 0 : RECORD_LENGTH, 1 == mode ? 1.0f : 0.0f, 0, ENVELOPE_EXPONENTIAL);
+        oscillator_bank_init(&bank, 1, 1);
+        for (size_t ivoice = 0; ivoice < 16; ivoice++)
+            oscillator_bank_add(&bank, (4 + ivoice) * 900.0f / 4.0f / sample_rate, 0.9f / 16);
+        if (mode) {
+            oscillator_bank_envelope(&bank, &envelope);
+            for (size_t ivoice = 0; ivoice < 16; ivoice++)
+                oscillator_bank_attack(&bank, ivoice, 0.9f / 16);
+        }
+
+        const double then = seconds_now();
+        for (size_t ival = 0; ival < RECORD_LENGTH; ival += 1024)
+            oscillator_bank_render(&bank, samples + ival, NULL, 1024);
+        printf("%s: %.2f ns per sample\n", 0 == mode ? "no envelope" : 1 == mode ? "sustaining" : "decaying",
+               (seconds_now() - then) * 1e9 / RECORD_LENGTH);
+    }
+}
+
+static void fm(void) {
+    /* a carrier modulated by an operator at twice its frequency with an index of 2, both steady,
+     against the exact sin(w n + 2 sin(2 w n)), and with feedback of 1 on the modulator, whose own
+     output is then y[n] = 2 sin(2 w n + y[n - 1] / 2 + y[n - 2] / 2), against the
+     same recurrence in double. then the host ns per voice per sample of sixteen voices for each
+     number of operators stacked, held, and with every envelope moving */
+    const double frequency = 440.0 / sample_rate;
+    static float samples[RECORD_LENGTH];
+    static struct fm_bank bank;
+    struct fm_patch patch = { .operators = 2, .algorithm = fm_algorithms[FM_STACK], .ratio = { 1.0f, 2.0f }, .level = { 1.0f, 2.0f } };
+    for (unsigned iop = 0; iop < FM_OPERATORS; iop++)
+        envelope_init(patch.envelope + iop, 0, 0, 1.0f, 0, ENVELOPE_EXPONENTIAL);
+
+    printf("%s: worst error against the exact phase modulation, and host ns per voice per sample of 16 voices\n", __func__);
+    for (int feedback = 0; feedback < 2; feedback++) {
+        patch.feedback[1] = feedback;
+        fm_bank_init(&bank, &patch);
+        fm_bank_add(&bank);
+        fm_note_on(&bank, 0, frequency, 0.5f);
+        for (size_t ival = 0; ival < RECORD_LENGTH; ival += 1024)
+            fm_bank_render(&bank, samples + ival, 1024);
+
+        double worst = 0.0, y1 = 0.0, y2 = 0.0;
+        for (size_t ival = 0; ival < RECORD_LENGTH; ival++) {
+            /* the phases in double from the rounded increments, which are what the bank uses */
+            const double phase = fmod(ival * (double)bank.increment[0][0], 4294967296.0) / 4294967296.0 * 2.0 * M_PI;
+            const double modulator_phase = fmod(ival * (double)bank.increment[1][0], 4294967296.0) / 4294967296.0 * 2.0 * M_PI;
+            const double modulator = 2.0 * sin(modulator_phase + feedback * (y1 + y2) / 2.0);
+            y2 = y1;
+            y1 = modulator;
+
+            const double error = fabs(samples[ival] - 0.5 * sin(phase + modulator));
+            if (error > worst) worst = error;
+        }
+        printf("%s: worst error %.3g%s\n", feedback ? "feedback" : "no feedback", worst, worst > 5e-5 ? "  exceeds bound" : "");
+        failures += worst > 5e-5;
+    }
+
+    const size_t voices = 16;
+    for (unsigned operators = 2; operators <= FM_OPERATORS; operators++)
+        for (int moving = 0; moving < 2; moving++) {
+            struct fm_patch stack = { .operators = operators, .algorithm = fm_algorithms[FM_STACK],
+                .ratio = { 1.0f, 3.5f, 1.0f, 7.0f }, .level = { 1.0f, 3.0f, 1.0f, 1.5f }, .feedback = { 0.0f, 0.0f, 0.0f, 0.5f } };
+            for (unsigned iop = 0; iop < FM_OPERATORS; iop++)
+                envelope_init(stack.envelope + iop, 0, moving ? 10 * RECORD_LENGTH : 0, moving ? 0.0f : 1.0f, 0, ENVELOPE_EXPONENTIAL);
+
+            fm_bank_init(&bank, &stack);
+            for (size_t ivoice = 0; ivoice < voices; ivoice++) {
+                fm_bank_add(&bank);
+                fm_note_on(&bank, ivoice, (4 + ivoice) * 110.0 / 4.0 / sample_rate, 0.9f / voices);
+            }
+
+            const double then = seconds_now();
+            for (size_t ival = 0; ival < RECORD_LENGTH; ival += 1024)
+                fm_bank_render(&bank, samples + ival, 1024);
+            printf("%u operators, %s: %.2f ns per voice per sample\n", operators, moving ? "moving" : "held",
+                   (seconds_now() - then) * 1e9 / RECORD_LENGTH / voices);
+        }
+}
+
+static double fundamental_hz(const float * x, const double frequency, const size_t length, const size_t gap) {
+    /* of a tone near frequency, in cycles per sample, from the advance of its phase at that frequency
+     between two hann-windowed records, gap samples apart, which resolves far finer than a bin */
+    double complex first = 0.0, second = 0.0;
+    for (size_t ival = 0; ival < length; ival++) {
+        const double w = 0.5 - 0.5 * cos(2.0 * M_PI * ival / length);
+        first += w * x[ival] * cexp(-2.0 * M_PI * I * frequency * ival);
+        second += w * x[ival + gap] * cexp(-2.0 * M_PI * I * frequency * (ival + gap));
+    }
+    return (frequency + carg(second * conj(first)) / (2.0 * M_PI * gap)) * sample_rate;
+}
+
+static void strings(void) {
+    /* the pitch of a string plucked at each frequency, measured from its fundamental, against that
+     of the nearest whole period in samples, which is what the loop would give without the allpass.
+     then the host ns per string per sample of sixteen strings, and the bytes of arena per string */
+    const double frequencies_hz[] = { 110.0, 440.0, 1760.0, 3520.0 };
+    const size_t length = 8192, gap = 8192;
+    static float samples[RECORD_LENGTH];
+    static struct pluck_bank bank;
+
+    printf("%s: error in cents of the pitch of a string, and host ns per string per sample of 16 strings\n", __func__);
+    printf("        Hz     cents  whole periods\n");
+    for (size_t ifrequency = 0; ifrequency < sizeof(frequencies_hz) / sizeof(frequencies_hz[0]); ifrequency++) {
+        const double frequency = frequencies_hz[ifrequency] / sample_rate;
+        pluck_bank_init(&bank);
+        pluck_bank_add(&bank, frequency);
+        pluck(&bank, 0, frequency, 0.9f, 3.0 * sample_rate, 1.0f);
+        for (size_t ival = 0; ival < RECORD_LENGTH; ival += 1024)
+            pluck_bank_render(&bank, samples + ival, 1024);
+
+        const double measured = fundamental_hz(samples + 1024, frequency, length, gap);
+        const double whole = round(1.0 / frequency - 0.5) + 0.5;
+        const double cents = 1200.0 * log2(measured / frequencies_hz[ifrequency]);
+        printf("%10.1f %9.4f %14.2f%s\n", frequencies_hz[ifrequency], cents, 1200.0 * log2(1.0 / whole / frequency),
+               fabs(cents) > 0.2 ? "  exceeds bound" : "");
+        failures += fabs(cents) > 0.2;
+    }
+
+    const size_t voices = 16;
+    pluck_bank_init(&bank);
+    for (size_t istring = 0; istring < voices; istring++) {
+        const double frequency = (4 + istring) * 55.0 / 4.0 / sample_rate;
+        pluck_bank_add(&bank, frequency);
+        pluck(&bank, istring, frequency, 0.9f / voices, 10 * RECORD_LENGTH, 0.5f);
+    }
+    const double then = seconds_now();
+    for (size_t ival = 0; ival < RECORD_LENGTH; ival += 1024)
+        pluck_bank_render(&bank, samples + ival, 1024);
+    printf("%zu strings from 55 Hz: %.2f ns per string per sample, %zu bytes of arena, %zu per string\n", voices,
+           (seconds_now() - then) * 1e9 / RECORD_LENGTH / voices, bank.arena_used * sizeof(float),
+           bank.arena_used * sizeof(float) / voices);
+}
+
+static const struct {
+    const char * name;
+    void (* func)(void);
+} benchmarks[] = {
+    { "quantizer_snr", quantizer_snr },
+    { "oversampling", oversampling },
+    { "dual_pwm", dual_pwm },
+    { "oscillator_bank", oscillator_bank },
+    { "renormalization", renormalization },
+    { "lanes", lanes },
+    { "fixed_point", fixed_point },
+    { "dds", dds },
+    { "dds_interp", dds_interp },
+    { "wavetable", wavetable },
+    { "polyblep", polyblep },
+    { "glide", glide },
+    { "events", events },
+    { "voices", voices },
+    { "envelopes", envelopes },
+    { "fm", fm },
+    { "strings", strings },
+};
+
+int main(int argc, char ** argv) {
+    for (size_t ibench = 0; ibench < sizeof(benchmarks) / sizeof(benchmarks[0]); ibench++) {
+        int wanted = argc < 2;
+        for (int iarg = 1; iarg < argc; iarg++)
+            if (!strcmp(argv[iarg], benchmarks[ibench].name)) wanted = 1;
+        if (wanted) benchmarks[ibench].func();
+    }
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
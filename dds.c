@@ -0,0 +1,102 @@
+#include "dds.h"
+
+#include <math.h>
+
+#ifdef PWM_AUDIO_HOST
+#include "interp_host.h"
+#else
+#include "hardware/interp.h"
+#endif
+
+#define TABLE_SIZE (1U << DDS_TABLE_BITS)
+#define FRACTION_BITS DDS_FRACTION_BITS
+
+float dds_table[TABLE_SIZE + 1];
+
+void dds_table_init(void) {
+    if (!dds_table[0])
+        for (size_t i = 0; i <= TABLE_SIZE; i++)
+            dds_table[i] = cos(2.0 * M_PI * i / TABLE_SIZE);
+}
+
+void dds_bank_init(struct dds_bank * bank) {
+    bank->count = 0;
+    dds_table_init();
+}
+
+size_t dds_bank_add(struct dds_bank * bank, const double frequency, const float amplitude) {
+    if (bank->count >= DDS_BANK_MAX) return DDS_BANK_MAX;
+
+    const size_t ivoice = bank->count++;
+    bank->phase[ivoice] = 0x80000000U;
+
+    /* negative frequencies wrap around, as they should */
+    bank->increment[ivoice] = (uint32_t)(int64_t)llround(frequency * 4294967296.0);
+    bank->amplitude[ivoice] = amplitude;
+    return ivoice;
+}
+
+void dds_bank_render(struct dds_bank * bank, float * re, float * im, const size_t count) {
+    const size_t voices = bank->count;
+    uint32_t * const restrict phase = bank->phase;
+    const uint32_t * const restrict increment = bank->increment;
+    const float * const restrict amplitude = bank->amplitude;
+
+    for (size_t ival = 0; ival < count; ival++) {
+        float sum_re = 0.0f, sum_im = 0.0f;
+        for (size_t ivoice = 0; ivoice < voices; ivoice++) {
+            sum_re += dds_cosine(phase[ivoice]) * amplitude[ivoice];
+
+            /* the sine is the cosine a quarter of a cycle earlier */
+            if (im) sum_im += dds_cosine(phase[ivoice] - 0x40000000U) * amplitude[ivoice];
+
+            phase[ivoice] += increment[ivoice];
+        }
+
+        re[ival] = sum_re;
+        if (im) im[ival] = sum_im;
+    }
+}
+
+void dds_bank_render_interp(struct dds_bank * bank, float * re, const size_t count) {
+    /* in both interpolators, lane 1 accumulates the phase, adding the increment on every pop. in
+     interp0, lane 0 takes the phase via cross input and makes the byte offset of its table entry,
+     which the load adds to the table address for free. in interp1, it takes the fraction bits */
+    interp_config accumulate = interp_default_config();
+    interp_set_config(interp0, 1, &accumulate);
+    interp_set_config(interp1, 1, &accumulate);
+
+    interp_config address = interp_default_config();
+    interp_config_set_cross_input(&address, true);
+    interp_config_set_shift(&address, FRACTION_BITS - 2);
+    interp_config_set_mask(&address, 2, DDS_TABLE_BITS + 1);
+    interp_set_config(interp0, 0, &address);
+    interp_set_base(interp0, 0, 0);
+
+    interp_config fraction = interp_default_config();
+    interp_config_set_cross_input(&fraction, true);
+    interp_config_set_mask(&fraction, 0, FRACTION_BITS - 1);
+    interp_set_config(interp1, 0, &fraction);
+    interp_set_base(interp1, 0, 0);
+
+    for (size_t ival = 0; ival < count; ival++)
+        re[ival] = 0.0f;
+
+    for (size_t ivoice = 0; ivoice < bank->count; ivoice++) {
+        const float amplitude = bank->amplitude[ivoice];
+        for (unsigned iinterp = 0; iinterp < 2; iinterp++) {
+            interp_hw_t * const interp = iinterp ? interp1 : interp0;
+            interp_set_accumulator(interp, 1, bank->phase[ivoice]);
+            interp_set_base(interp, 1, bank->increment[ivoice]);
+        }
+
+        /* accumulate in the same order as dds_bank_render(), which sums voices within each sample */
+        for (size_t ival = 0; ival < count; ival++) {
+            const float * const entry = (const float *)((const char *)dds_table + interp_pop_lane_result(interp0, 0));
+            const float f = interp_pop_lane_result(interp1, 0) * (1.0f / (1U << FRACTION_BITS));
+            re[ival] += (entry[0] + f * (entry[1] - entry[0])) * amplitude;
+        }
+
+        bank->phase[ivoice] = interp_get_accumulator(interp0, 1);
+    }
+}
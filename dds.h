@@ -0,0 +1,55 @@
+#ifndef DDS_H
+#define DDS_H
+
+/* direct digital synthesis: a bank of voices, each a 32-bit phase accumulator advanced by a fixed
+ increment every sample, indexing a cosine table with linear interpolation between entries. unlike
+ the rotator of oscillators.h, whose advance is rounded to float and whose rounding errors
+ accumulate, the phase here is exact modulo 2^32, so each frequency is exactly the increment times
+ the sample rate over 2^32, i.e. to within about 11 uHz at 46875 Hz, and as exact as the crystal
+ over any length of time. the table costs 4 kB, and interpolation keeps its error near -100 dB */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define DDS_BANK_MAX 128
+
+/* log2 of the number of table entries per cycle */
+#define DDS_TABLE_BITS 10
+
+/* bits of the phase below the table index, which give the interpolation fraction */
+#define DDS_FRACTION_BITS (32 - DDS_TABLE_BITS)
+
+/* the cosine table, with one extra entry, so that interpolation never needs to wrap, shared with
+ anything else which needs a cheap cosine of a 32-bit phase, see fm.h. built by the first call */
+extern float dds_table[(1U << DDS_TABLE_BITS) + 1];
+void dds_table_init(void);
+
+static inline float dds_cosine(const uint32_t phase) {
+    const uint32_t index = phase >> DDS_FRACTION_BITS;
+    const float fraction = (phase & ((1U << DDS_FRACTION_BITS) - 1)) * (1.0f / (1U << DDS_FRACTION_BITS));
+    return dds_table[index] + fraction * (dds_table[index + 1] - dds_table[index]);
+}
+
+struct dds_bank {
+    size_t count;
+    uint32_t phase[DDS_BANK_MAX], increment[DDS_BANK_MAX];
+    float amplitude[DDS_BANK_MAX];
+};
+
+void dds_bank_init(struct dds_bank * bank);
+
+/* frequency is in cycles per sample, in double so that the increment can be rounded from it
+ exactly, and the phase starts at pi, as for the rotator. returns the index of the new voice, or
+ DDS_BANK_MAX if the bank is full */
+size_t dds_bank_add(struct dds_bank * bank, const double frequency, const float amplitude);
+
+/* writes count samples of the sum of the cosines to re, and if im is not null, the sines to im */
+void dds_bank_render(struct dds_bank * bank, float * re, float * im, const size_t count);
+
+/* as dds_bank_render() without im, and bit-for-bit the same, but with the phase accumulation, table
+ address and interpolation fraction of each sample generated by the sio interpolators, interp0 for
+ the address and interp1 for the fraction, one voice at a time, so that the core only does the
+ loads and the interpolation itself. on the host, the interpolators are emulated in software */
+void dds_bank_render_interp(struct dds_bank * bank, float * re, const size_t count);
+
+#endif
@@ -0,0 +1,75 @@
+#include "envelope.h"
+
+#include <math.h>
+
+static float factor(const size_t samples) {
+    /* covers all but 1 / e of the remaining way in samples / ENVELOPE_TIME_CONSTANTS */
+    return samples ? exp(-(double)ENVELOPE_TIME_CONSTANTS / samples) : 0.0f;
+}
+
+void envelope_init(struct envelope * envelope, const size_t attack, const size_t decay, const float sustain, const size_t release,
+                   const enum envelope_shape shape) {
+    *envelope = (struct envelope) {
+        .attack = attack, .decay = decay, .release = release,
+        .sustain = sustain < 0.0f ? 0.0f : sustain > 1.0f ? 1.0f : sustain,
+        .shape = shape,
+        .decay_factor = factor(decay), .release_factor = factor(release),
+    };
+}
+
+int envelope_moving(const enum envelope_stage stage) {
+    return ENVELOPE_ATTACK == stage || ENVELOPE_DECAY == stage || ENVELOPE_RELEASE == stage;
+}
+
+size_t envelope_length(const struct envelope * envelope, const enum envelope_stage stage) {
+    return ENVELOPE_ATTACK == stage ? envelope->attack : ENVELOPE_DECAY == stage ? envelope->decay :
+        ENVELOPE_RELEASE == stage ? envelope->release : 0;
+}
+
+float envelope_target(const struct envelope * envelope, const enum envelope_stage stage, const float peak) {
+    switch (stage) {
+        case ENVELOPE_ATTACK: return peak;
+        case ENVELOPE_DECAY:
+        case ENVELOPE_SUSTAIN: return peak * envelope->sustain;
+        default: return 0.0f;
+    }
+}
+
+enum envelope_stage envelope_next(const struct envelope * envelope, const enum envelope_stage stage) {
+    return ENVELOPE_ATTACK == stage ? ENVELOPE_DECAY : ENVELOPE_DECAY == stage && envelope->sustain ? ENVELOPE_SUSTAIN : ENVELOPE_IDLE;
+}
+
+int envelope_start(const struct envelope * envelope, const enum envelope_stage next, const float peak, enum envelope_stage * stage,
+                   size_t * remaining, float * amplitude, float * factor, float * step) {
+    const int was_moving = envelope_moving(*stage);
+    *factor = 1.0f;
+    *step = 0.0f;
+
+    for (*stage = next; ; *stage = envelope_next(envelope, *stage)) {
+        *remaining = envelope_length(envelope, *stage);
+        if (!envelope_moving(*stage) || *remaining) break;
+        *amplitude = envelope_target(envelope, *stage, peak);
+    }
+    return envelope_moving(*stage) - was_moving;
+}
+
+int envelope_advance(const struct envelope * envelope, const size_t block, const float peak, enum envelope_stage * stage,
+                     size_t * remaining, float * amplitude, float * factor, float * step) {
+    *remaining -= block;
+    if (*remaining) return 0;
+
+    *amplitude = envelope_target(envelope, *stage, peak);
+    return envelope_start(envelope, envelope_next(envelope, *stage), peak, stage, remaining, amplitude, factor, step);
+}
+
+void envelope_coefficients(const struct envelope * envelope, const enum envelope_stage stage, const float amplitude,
+                           const float target, const size_t remaining, float * factor, float * step) {
+    /* linear for the attack, and for the rest as the envelope says */
+    if (ENVELOPE_ATTACK == stage || ENVELOPE_LINEAR == envelope->shape) {
+        *factor = 1.0f;
+        *step = (target - amplitude) / remaining;
+    } else {
+        *factor = ENVELOPE_DECAY == stage ? envelope->decay_factor : envelope->release_factor;
+        *step = target * (1.0f - *factor);
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef ENVELOPE_H
+#define ENVELOPE_H
+
+/* attack, decay, sustain and release envelopes, for the voices of the bank of phasors and the
+ operators of fm voices, whose state lives alongside the rest of each voice in its bank. the attack
+ is a linear ramp up to the peak of the note, while decay and release are either linear ramps or
+ exponential approaches to their targets, which are snapped to them after their durations, once
+ they are within about 1e-3 of the way there. either way, each is applied per sample as the
+ recurrence amplitude = amplitude x factor + step, whose coefficients are computed once per
+ segment of the bank, see oscillators.h, and the factors of exponential segments once for all, by
+ envelope_init() */
+
+#include <stddef.h>
+
+/* an exponential segment, of an envelope or a glide of the bank, is snapped to its target after this
+ many time constants, when it is within about 1e-3 of the way there */
+#define ENVELOPE_TIME_CONSTANTS 7
+
+enum envelope_shape {
+    ENVELOPE_LINEAR,
+    ENVELOPE_EXPONENTIAL,
+};
+
+enum envelope_stage {
+    ENVELOPE_IDLE,
+    ENVELOPE_ATTACK,
+    ENVELOPE_DECAY,
+    ENVELOPE_SUSTAIN,
+    ENVELOPE_RELEASE,
+};
+
+struct envelope {
+    /* durations in samples, and the sustain level as a fraction of the peak */
+    size_t attack, decay, release;
+    float sustain;
+    enum envelope_shape shape;
+
+    /* per sample, for exponential decay and release */
+    float decay_factor, release_factor;
+};
+
+void envelope_init(struct envelope * envelope, const size_t attack, const size_t decay, const float sustain, const size_t release,
+                   const enum envelope_shape shape);
+
+/* whether the amplitude moves in a stage, which is so of the attack, decay and release */
+int envelope_moving(const enum envelope_stage stage);
+
+/* the length of a stage in samples, the amplitude it heads for in a note of the given peak, and
+ the stage after it, where a decay to a sustain of 0 is the end of the note, as for a percussive sound */
+size_t envelope_length(const struct envelope * envelope, const enum envelope_stage stage);
+float envelope_target(const struct envelope * envelope, const enum envelope_stage stage, const float peak);
+enum envelope_stage envelope_next(const struct envelope * envelope, const enum envelope_stage stage);
+
+/* the stepping of one envelope of a bank, given pointers to its stage, the samples left in it, its
+ amplitude, and the coefficients of its recurrence, which are reset to hold the amplitude, until
+ they are next computed for a moving stage. envelope_start() starts the given stage, from the one
+ in progress, and envelope_advance() takes a block of samples, no more than are left, off a moving
+ stage, and if that ends it, lands on its target and starts the next. either way, a stage of no
+ length lands on its target at once, and moves on. each returns the change in the number of
+ moving envelopes, which the bank keeps count of */
+int envelope_start(const struct envelope * envelope, const enum envelope_stage next, const float peak, enum envelope_stage * stage,
+                   size_t * remaining, float * amplitude, float * factor, float * step);
+int envelope_advance(const struct envelope * envelope, const size_t block, const float peak, enum envelope_stage * stage,
+                     size_t * remaining, float * amplitude, float * factor, float * step);
+
+/* the coefficients of the recurrence over a segment of a moving stage, from the amplitude at its
+ start and the samples left in the stage, such that a linear stage lands exactly on its target */
+void envelope_coefficients(const struct envelope * envelope, const enum envelope_stage stage, const float amplitude,
+                           const float target, const size_t remaining, float * factor, float * step);
+
+#endif
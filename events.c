@@ -0,0 +1,54 @@
+#include "events.h"
+
+#include <string.h>
+
+void event_queue_init(struct event_queue * queue) {
+    queue->count = 0;
+}
+
+int event_post(struct event_queue * queue, const struct event * event) {
+    if (queue->count >= EVENT_QUEUE_MAX) return 0;
+
+    /* after everything due at or before it, shifting the rest up, which for a queue this short is
+     cheaper than keeping a heap, and keeps events at the same time in the order they were posted */
+    size_t i = queue->count;
+    while (i && queue->events[i - 1].time > event->time) i--;
+    memmove(queue->events + i + 1, queue->events + i, (queue->count - i) * sizeof(struct event));
+    queue->events[i] = *event;
+    queue->count++;
+    return 1;
+}
+
+static void apply(struct voice_pool * pool, const struct event * event) {
+    switch (event->type) {
+        case EVENT_NOTE_ON:
+            voice_note_on(pool, event->note, event->frequency, event->amplitude, event->samples);
+            break;
+        case EVENT_NOTE_OFF:
+            voice_note_off(pool, event->note, event->samples);
+            break;
+        case EVENT_SET:
+        case EVENT_RAMP: {
+            const size_t ivoice = voice_find(pool, event->note);
+            if (ivoice < pool->bank->count)
+                oscillator_bank_retune(pool->bank, ivoice, event->frequency, event->amplitude,
+                                       EVENT_SET == event->type ? 0 : event->samples, event->glide);
+            break;
+        }
+    }
+}
+
+size_t event_dispatch(struct event_queue * queue, struct voice_pool * pools, const uint64_t time, const size_t limit) {
+    size_t due = 0;
+    while (due < queue->count && queue->events[due].time <= time) {
+        apply(pools + queue->events[due].output, queue->events + due);
+        due++;
+    }
+
+    if (due) {
+        queue->count -= due;
+        memmove(queue->events, queue->events + due, queue->count * sizeof(struct event));
+    }
+
+    return queue->count && queue->events[0].time - time < limit ? queue->events[0].time - time : limit;
+}
@@ -0,0 +1,68 @@
+#ifndef EVENTS_H
+#define EVENTS_H
+
+/* a queue of time-stamped events, each due at an absolute index of synthesized samples, i.e. the
+ chunk index times the samples synthesized per chunk plus the offset within it. the renderer
+ splits each chunk into sub-blocks which end wherever an event is due, and applies the events due
+ at the start of each before rendering it, so each event lands on its own sample, 21 us at 46875
+ Hz, rather than on the next chunk boundary, while everything between events is still rendered in
+ blocks. events which are already late, e.g. after an underrun, are applied at once */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "oscillators.h"
+#include "voices.h"
+
+/* events pending across all outputs, which the firmware and host simulation size for the beeps of
+ the demo on the channels configured, see CMakeLists.txt */
+#ifndef EVENT_QUEUE_MAX
+#define EVENT_QUEUE_MAX 64
+#endif
+
+enum event_type {
+    /* start the note on a voice from the pool, ramping its amplitude up over the given samples */
+    EVENT_NOTE_ON,
+
+    /* release the note, ramping its amplitude down to 0 over the given samples */
+    EVENT_NOTE_OFF,
+
+    /* set the frequency and amplitude of the note at once */
+    EVENT_SET,
+
+    /* ramp or glide the frequency and amplitude of the note */
+    EVENT_RAMP,
+};
+
+struct event {
+    uint64_t time;
+    enum event_type type;
+
+    /* which bank, by its voice pool, and which note within it */
+    size_t output;
+    uint32_t note;
+
+    /* frequency in cycles per sample, and amplitude, as for oscillator_bank_retune(), and the
+     length of the ramp in samples, or the time constant of the glide */
+    float frequency, amplitude;
+    size_t samples;
+    enum oscillator_glide glide;
+};
+
+struct event_queue {
+    /* in order of time, and of posting within the same time */
+    size_t count;
+    struct event events[EVENT_QUEUE_MAX];
+};
+
+void event_queue_init(struct event_queue * queue);
+
+/* returns nonzero if the event was queued, or 0 if the queue is full */
+int event_post(struct event_queue * queue, const struct event * event);
+
+/* applies every event due at or before the given time to its note in pools, indexed by output,
+ and returns the number of samples until the next event is due, at most limit, which is how many
+ to render before calling this again */
+size_t event_dispatch(struct event_queue * queue, struct voice_pool * pools, const uint64_t time, const size_t limit);
+
+#endif
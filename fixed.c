@@ -0,0 +1,108 @@
+#include "fixed.h"
+#include "quantize.h"
+
+#define ONE (1 << 30)
+
+/* atan(2^-i) in turns, scaled by 2^32 */
+static const uint32_t atan_table[] = {
+    0x20000000, 0x12E4051E, 0x09FB385B, 0x051111D4, 0x028B0D43, 0x0145D7E1,
+    0x00A2F61E, 0x00517C55, 0x0028BE53, 0x00145F2F, 0x000A2F98, 0x000517CC,
+    0x00028BE6, 0x000145F3, 0x0000A2FA, 0x0000517D, 0x000028BE, 0x0000145F,
+    0x00000A30, 0x00000518, 0x0000028C, 0x00000146, 0x000000A3, 0x00000051,
+    0x00000029, 0x00000014, 0x0000000A, 0x00000005, 0x00000003, 0x00000001,
+};
+
+/* the product of the cordic gains, which the initial vector is scaled by, in q2.30 */
+#define CORDIC_GAIN 652032874
+
+static int32_t multiply(const int32_t a, const int32_t b) {
+    /* q2.30 times q2.30, rounded */
+    return ((int64_t)a * b + (1 << 29)) >> 30;
+}
+
+void fixed_cis(const uint32_t phase, int32_t * re, int32_t * im) {
+    /* cordic only converges within about a quarter turn, so take the other half of the circle by
+     negating the result */
+    int32_t z = phase;
+    const int flip = z > 0x40000000 || z < -0x40000000;
+    if (flip) z += 0x80000000U;
+
+    int32_t x = CORDIC_GAIN, y = 0;
+    for (size_t i = 0; i < sizeof(atan_table) / sizeof(atan_table[0]); i++) {
+        const int32_t dx = y >> i, dy = x >> i;
+        if (z >= 0) {
+            x -= dx;
+            y += dy;
+            z -= atan_table[i];
+        } else {
+            x += dx;
+            y -= dy;
+            z += atan_table[i];
+        }
+    }
+
+    *re = flip ? -x : x;
+    *im = flip ? -y : y;
+}
+
+void fixed_bank_init(struct fixed_bank * bank) {
+    bank->count = 0;
+}
+
+size_t fixed_bank_add(struct fixed_bank * bank, const float frequency, const float amplitude) {
+    if (bank->count >= FIXED_BANK_MAX) return FIXED_BANK_MAX;
+
+    const size_t ivoice = bank->count++;
+    bank->re[ivoice] = -ONE;
+    bank->im[ivoice] = 0;
+
+    /* frequency in turns per sample as a 32-bit phase, which wraps as it should for negative ones */
+    const int64_t phase = (int64_t)(frequency * 4294967296.0f);
+    fixed_cis((uint32_t)phase, bank->advance_re + ivoice, bank->advance_im + ivoice);
+    bank->amplitude[ivoice] = (int32_t)(amplitude * 32768.0f);
+    return ivoice;
+}
+
+void fixed_bank_render(struct fixed_bank * bank, int32_t * re, int32_t * im, const size_t count) {
+    const size_t voices = bank->count;
+    int32_t * const restrict vre = bank->re, * const restrict vim = bank->im;
+    const int32_t * const restrict are = bank->advance_re, * const restrict aim = bank->advance_im;
+    const int32_t * const restrict amplitude = bank->amplitude;
+
+    for (size_t ival = 0; ival < count; ival++) {
+        /* q2.30 times q15 is q45, of which q31 is the top */
+        int64_t sum_re = 0, sum_im = 0;
+        for (size_t ivoice = 0; ivoice < voices; ivoice++) {
+            sum_re += (int64_t)vre[ivoice] * amplitude[ivoice];
+            sum_im += (int64_t)vim[ivoice] * amplitude[ivoice];
+
+            /* rotate complex sinusoid at the desired frequency */
+            const int32_t next_re = ((int64_t)vre[ivoice] * are[ivoice] - (int64_t)vim[ivoice] * aim[ivoice] + (1 << 29)) >> 30;
+            const int32_t next_im = ((int64_t)vre[ivoice] * aim[ivoice] + (int64_t)vim[ivoice] * are[ivoice] + (1 << 29)) >> 30;
+
+            /* renormalize to unity, by the same newton step as in float */
+            const int32_t gain = (3 * (int64_t)ONE - (((int64_t)next_re * next_re + (int64_t)next_im * next_im + (1 << 29)) >> 30)) >> 1;
+            vre[ivoice] = multiply(next_re, gain);
+            vim[ivoice] = multiply(next_im, gain);
+        }
+
+        sum_re >>= 14;
+        sum_im >>= 14;
+        re[ival] = sum_re > INT32_MAX ? INT32_MAX : sum_re < INT32_MIN ? INT32_MIN : sum_re;
+        if (im) im[ival] = sum_im > INT32_MAX ? INT32_MAX : sum_im < INT32_MIN ? INT32_MIN : sum_im;
+    }
+}
+
+void quantize_fixed(const unsigned top, uint16_t * dst, const size_t stride, const int32_t * src, const size_t count) {
+    for (size_t ival = 0; ival < count; ival++) {
+        /* map [-1.0, 1.0) to [0, top) levels, with 32 fractional bits */
+        const int64_t wanted = ((int64_t)src[ival] + 0x80000000LL) * top;
+
+        /* round with triangular pdf dither, from two 23-bit uniforms like frand_minus_frand(),
+         within the range of the pwm */
+        const uint64_t bits = xorshift64star();
+        const int64_t tpdf = ((int64_t)((bits >> 41) & 0x7FFFFF) - (int64_t)((bits >> 18) & 0x7FFFFF)) << 9;
+        const int64_t dithered = (wanted + 0x80000000LL + tpdf) >> 32;
+        dst[ival * stride] = dithered < 0 ? 0 : dithered > top ? top : dithered;
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef FIXED_H
+#define FIXED_H
+
+/* integer-only variant of the synthesis and quantization, for the hazard3 risc-v cores, which have
+ no fpu, or wherever the output must be bit-exact between the host simulation and the target. all
+ arithmetic, including the derivation of each advance from its frequency, is done in integers,
+ with no use of libm, so the same inputs give the same levels everywhere.
+
+ phasors and advances are q2.30, i.e. unit magnitude is 1 << 30, leaving headroom for the
+ magnitude to overshoot slightly between renormalizations, amplitudes are q15 with 1 << 15 as
+ full scale, and samples are q31, saturated. dither and quantization to pwm levels are done as
+ in quantize(), without noise shaping, with the same random sequence */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define FIXED_BANK_MAX 128
+
+struct fixed_bank {
+    size_t count;
+    int32_t re[FIXED_BANK_MAX], im[FIXED_BANK_MAX];
+    int32_t advance_re[FIXED_BANK_MAX], advance_im[FIXED_BANK_MAX];
+    int32_t amplitude[FIXED_BANK_MAX];
+};
+
+/* cosine and sine of a phase in turns, as a full-range uint32, in q2.30, by cordic */
+void fixed_cis(const uint32_t phase, int32_t * re, int32_t * im);
+
+void fixed_bank_init(struct fixed_bank * bank);
+
+/* frequency is in cycles per sample, and amplitude relative to full scale, both converted exactly
+ once, as ieee float arithmetic is deterministic. returns the index of the new voice, or
+ FIXED_BANK_MAX if the bank is full */
+size_t fixed_bank_add(struct fixed_bank * bank, const float frequency, const float amplitude);
+
+/* as oscillator_bank_render() with per-sample renormalization, in q31 */
+void fixed_bank_render(struct fixed_bank * bank, int32_t * re, int32_t * im, const size_t count);
+
+/* as quantize() with no noise shaping, from q31 */
+void quantize_fixed(const unsigned top, uint16_t * dst, const size_t stride, const int32_t * src, const size_t count);
+
+#endif
@@ -0,0 +1,195 @@
+#include "fm.h"
+#include "dds.h"
+
+#include <math.h>
+
+/* phase steps of 2^FM_MODULATION_SHIFT per radian */
+#define MODULATION_SCALE ((float)(1U << (32 - FM_MODULATION_SHIFT)) / (2.0f * (float)M_PI))
+
+/* cos of this is 0, rising, so that each operator starts as a sine, without a step */
+#define PHASE_START 0xC0000000U
+
+const struct fm_algorithm fm_algorithms[FM_ALGORITHMS] = {
+    [FM_STACK] = { .modulators = { 1U << 1, 1U << 2, 1U << 3, 0 }, .carriers = 1U << 0 },
+    [FM_BRANCH] = { .modulators = { 1U << 1, 1U << 2 | 1U << 3, 0, 0 }, .carriers = 1U << 0 },
+    [FM_PAIRS] = { .modulators = { 1U << 1, 0, 1U << 3, 0 }, .carriers = 1U << 0 | 1U << 2 },
+    [FM_FAN] = { .modulators = { 1U << 3, 1U << 3, 1U << 3, 0 }, .carriers = 1U << 0 | 1U << 1 | 1U << 2 },
+    [FM_ADDITIVE] = { .modulators = { 0, 0, 0, 0 }, .carriers = 0xF },
+};
+
+static float clamp(const float x, const float lo, const float hi) {
+    return x < lo ? lo : x > hi ? hi : x;
+}
+
+void fm_bank_init(struct fm_bank * bank, const struct fm_patch * patch) {
+    bank->count = 0;
+    bank->patch = patch;
+    bank->moving = 0;
+    dds_table_init();
+
+    /* only from higher-numbered operators of the patch, so that there are no loops other than feedback */
+    const unsigned operators = patch->operators < 1 ? 1 : patch->operators > FM_OPERATORS ? FM_OPERATORS : patch->operators;
+    unsigned carriers = 0;
+    for (unsigned iop = 0; iop < FM_OPERATORS; iop++)
+        carriers += iop < operators && (patch->algorithm.carriers >> iop & 1);
+
+    for (unsigned iop = 0; iop < FM_OPERATORS; iop++) {
+        for (unsigned imod = 0; imod < FM_OPERATORS; imod++)
+            bank->route[iop][imod] = iop < imod && imod < operators && (patch->algorithm.modulators[iop] >> imod & 1);
+        bank->carrier[iop] = iop < operators && (patch->algorithm.carriers >> iop & 1) ? 1.0f / carriers : 0.0f;
+        bank->level[iop] = iop < operators ? clamp(patch->level[iop], 0.0f, FM_LEVEL_MAX) : 0.0f;
+        bank->feedback[iop] = 0.5f * clamp(patch->feedback[iop], 0.0f, FM_FEEDBACK_MAX);
+    }
+}
+
+size_t fm_bank_add(struct fm_bank * bank) {
+    if (bank->count >= FM_BANK_MAX) return FM_BANK_MAX;
+
+    const size_t ivoice = bank->count++;
+    for (unsigned iop = 0; iop < FM_OPERATORS; iop++) {
+        bank->phase[iop][ivoice] = PHASE_START;
+        bank->increment[iop][ivoice] = 0;
+        bank->amplitude[iop][ivoice] = 0.0f;
+        bank->factor[iop][ivoice] = 1.0f;
+        bank->step[iop][ivoice] = 0.0f;
+        bank->output[iop][ivoice] = 0.0f;
+        bank->previous[iop][ivoice] = 0.0f;
+        bank->stage[iop][ivoice] = ENVELOPE_IDLE;
+    }
+    bank->peak[ivoice] = 0.0f;
+    return ivoice;
+}
+
+static float operator_peak(const struct fm_bank * bank, const unsigned iop, const size_t ivoice) {
+    /* carriers scale with the note, and modulators do not, so that loudness does not change timbre */
+    return bank->level[iop] * (bank->carrier[iop] ? bank->peak[ivoice] : 1.0f);
+}
+
+static float stage_target(const struct fm_bank * bank, const unsigned iop, const size_t ivoice) {
+    return envelope_target(bank->patch->envelope + iop, bank->stage[iop][ivoice], operator_peak(bank, iop, ivoice));
+}
+
+static void start_stage(struct fm_bank * bank, const unsigned iop, const size_t ivoice, const enum envelope_stage stage) {
+    bank->moving += envelope_start(bank->patch->envelope + iop, stage, operator_peak(bank, iop, ivoice), bank->stage[iop] + ivoice,
+                                   bank->stage_remaining[iop] + ivoice, bank->amplitude[iop] + ivoice, bank->factor[iop] + ivoice,
+                                   bank->step[iop] + ivoice);
+}
+
+int fm_voice_idle(const struct fm_bank * bank, const size_t ivoice) {
+    for (unsigned iop = 0; iop < FM_OPERATORS; iop++)
+        if (bank->carrier[iop] && ENVELOPE_IDLE != bank->stage[iop][ivoice]) return 0;
+    return 1;
+}
+
+void fm_note_on(struct fm_bank * bank, const size_t ivoice, const double frequency, const float amplitude) {
+    if (ivoice >= bank->count) return;
+
+    const int restart = fm_voice_idle(bank, ivoice);
+    bank->peak[ivoice] = amplitude;
+    for (unsigned iop = 0; iop < bank->patch->operators && iop < FM_OPERATORS; iop++) {
+        /* negative frequencies wrap around, as they should */
+        bank->increment[iop][ivoice] = (uint32_t)(int64_t)llround(frequency * bank->patch->ratio[iop] * 4294967296.0);
+        if (restart) {
+            bank->phase[iop][ivoice] = PHASE_START;
+            bank->output[iop][ivoice] = 0.0f;
+            bank->previous[iop][ivoice] = 0.0f;
+        }
+        start_stage(bank, iop, ivoice, ENVELOPE_ATTACK);
+    }
+}
+
+void fm_note_off(struct fm_bank * bank, const size_t ivoice) {
+    if (ivoice >= bank->count) return;
+    for (unsigned iop = 0; iop < bank->patch->operators && iop < FM_OPERATORS; iop++)
+        if (ENVELOPE_IDLE != bank->stage[iop][ivoice])
+            start_stage(bank, iop, ivoice, ENVELOPE_RELEASE);
+}
+
+static size_t begin_block(struct fm_bank * bank, const size_t count) {
+    /* with no envelope moving, the whole of the rest is one block, and otherwise it ends no later
+     than the first stage to finish, so that each lands exactly */
+    if (!bank->moving) return count;
+
+    size_t block = count < FM_BLOCK ? count : FM_BLOCK;
+    for (unsigned iop = 0; iop < FM_OPERATORS; iop++)
+        for (size_t ivoice = 0; ivoice < bank->count; ivoice++)
+            if (envelope_moving(bank->stage[iop][ivoice]) && bank->stage_remaining[iop][ivoice] < block)
+                block = bank->stage_remaining[iop][ivoice];
+
+    for (unsigned iop = 0; iop < FM_OPERATORS; iop++)
+        for (size_t ivoice = 0; ivoice < bank->count; ivoice++)
+            if (envelope_moving(bank->stage[iop][ivoice]))
+                envelope_coefficients(bank->patch->envelope + iop, bank->stage[iop][ivoice], bank->amplitude[iop][ivoice],
+                                      stage_target(bank, iop, ivoice), bank->stage_remaining[iop][ivoice],
+                                      bank->factor[iop] + ivoice, bank->step[iop] + ivoice);
+    return block;
+}
+
+static void end_block(struct fm_bank * bank, const size_t block) {
+    if (!bank->moving) return;
+
+    for (unsigned iop = 0; iop < FM_OPERATORS; iop++)
+        for (size_t ivoice = 0; ivoice < bank->count; ivoice++)
+            if (envelope_moving(bank->stage[iop][ivoice]))
+                bank->moving += envelope_advance(bank->patch->envelope + iop, block, operator_peak(bank, iop, ivoice),
+                                                 bank->stage[iop] + ivoice, bank->stage_remaining[iop] + ivoice,
+                                                 bank->amplitude[iop] + ivoice, bank->factor[iop] + ivoice, bank->step[iop] + ivoice);
+}
+
+static void render_voice(struct fm_bank * bank, const size_t ivoice, float * dst, const size_t count) {
+    const unsigned operators = bank->patch->operators < FM_OPERATORS ? bank->patch->operators : FM_OPERATORS;
+
+    /* the state of the voice, in registers for the length of the block */
+    uint32_t phase[FM_OPERATORS], increment[FM_OPERATORS];
+    float amplitude[FM_OPERATORS], factor[FM_OPERATORS], step[FM_OPERATORS], output[FM_OPERATORS], previous[FM_OPERATORS];
+    for (unsigned iop = 0; iop < operators; iop++) {
+        phase[iop] = bank->phase[iop][ivoice];
+        increment[iop] = bank->increment[iop][ivoice];
+        amplitude[iop] = bank->amplitude[iop][ivoice];
+        factor[iop] = bank->factor[iop][ivoice];
+        step[iop] = bank->step[iop][ivoice];
+        output[iop] = bank->output[iop][ivoice];
+        previous[iop] = bank->previous[iop][ivoice];
+    }
+
+    for (size_t ival = 0; ival < count; ival++) {
+        float sum = 0.0f;
+        for (unsigned iop = operators; iop--; ) {
+            /* the mean of the last two outputs smooths feedback, which otherwise tends to a squeal */
+            float modulation = bank->feedback[iop] * (output[iop] + previous[iop]);
+            for (unsigned imod = iop + 1; imod < operators; imod++)
+                modulation += bank->route[iop][imod] * output[imod];
+
+            /* through int32, and then scaled up to the phase, since float to int32 is one instruction */
+            const uint32_t offset = (uint32_t)(int32_t)(modulation * MODULATION_SCALE) << FM_MODULATION_SHIFT;
+
+            previous[iop] = output[iop];
+            output[iop] = dds_cosine(phase[iop] + offset) * amplitude[iop];
+            sum += bank->carrier[iop] * output[iop];
+
+            amplitude[iop] = amplitude[iop] * factor[iop] + step[iop];
+            phase[iop] += increment[iop];
+        }
+        dst[ival] += sum;
+    }
+
+    for (unsigned iop = 0; iop < operators; iop++) {
+        bank->phase[iop][ivoice] = phase[iop];
+        bank->amplitude[iop][ivoice] = amplitude[iop];
+        bank->output[iop][ivoice] = output[iop];
+        bank->previous[iop][ivoice] = previous[iop];
+    }
+}
+
+void fm_bank_render(struct fm_bank * bank, float * dst, const size_t count) {
+    for (size_t ival = 0; ival < count; ival++)
+        dst[ival] = 0.0f;
+
+    for (size_t ival = 0, block; ival < count; ival += block) {
+        block = begin_block(bank, count - ival);
+        for (size_t ivoice = 0; ivoice < bank->count; ivoice++)
+            if (!fm_voice_idle(bank, ivoice))
+                render_voice(bank, ivoice, dst + ival, block);
+        end_block(bank, block);
+    }
+}
@@ -0,0 +1,110 @@
+#ifndef FM_H
+#define FM_H
+
+/* frequency modulation synthesis, or strictly phase modulation, as in the classic fm chips: each
+ voice is two to four operators, each a sine from the cosine table of dds.h at a fixed ratio to
+ the frequency of the note, whose phase is offset by the outputs of the operators which modulate
+ it, and optionally by its own previous output, which is its feedback. the algorithm says which
+ operators modulate which, and which are heard. each operator has its own envelope, which for a
+ modulator sets its modulation index over the note, and so the brightness, and for a carrier its
+ loudness. the rotator of oscillators.h cannot be modulated like this, as its phase is implicit.
+
+ voices are rendered one at a time in blocks of at most FM_BLOCK samples, before each of which the
+ coefficients of every moving envelope are computed, see envelope.h, so that within a block each
+ operator costs an interpolated table lookup, a multiply-add per modulator, and one for its
+ envelope, per sample, with the state of the voice in registers */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "envelope.h"
+
+#define FM_BANK_MAX 32
+#define FM_OPERATORS 4
+#define FM_BLOCK 32
+
+/* modulation is added to the phase in steps of 2^FM_MODULATION_SHIFT, so that it can be converted
+ from float through int32, which covers +-32 cycles, about +-200 radians, more than the sum of the
+ bounds below. the steps are still far finer than the interpolation of the table can resolve */
+#define FM_MODULATION_SHIFT 6
+
+/* bounds on the level of each operator, which for a modulator is its peak index in radians, and on
+ feedback, which is the index of an operator into itself per unit of its output */
+#define FM_LEVEL_MAX 12.5f
+#define FM_FEEDBACK_MAX 2.0f
+
+/* which operators modulate each, as a bit mask of higher-numbered operators, so that each voice is
+ computed from the last operator down, and which are heard, each at the same gain. bits beyond the
+ operators of a patch are ignored, so that each algorithm also makes sense with fewer of them */
+struct fm_algorithm {
+    uint8_t modulators[FM_OPERATORS];
+    uint8_t carriers;
+};
+
+enum fm_algorithm_preset {
+    FM_STACK,       /* 3 -> 2 -> 1 -> 0 */
+    FM_BRANCH,      /* 3 -> 1, 2 -> 1 -> 0 */
+    FM_PAIRS,       /* 1 -> 0, 3 -> 2 */
+    FM_FAN,         /* 3 -> 0, 1 and 2 */
+    FM_ADDITIVE,    /* no modulation, all heard */
+    FM_ALGORITHMS,
+};
+
+extern const struct fm_algorithm fm_algorithms[FM_ALGORITHMS];
+
+struct fm_patch {
+    unsigned operators;
+    struct fm_algorithm algorithm;
+
+    /* per operator, the frequency as a ratio to that of the note, the peak level, feedback, and
+     the envelope */
+    float ratio[FM_OPERATORS], level[FM_OPERATORS], feedback[FM_OPERATORS];
+    struct envelope envelope[FM_OPERATORS];
+};
+
+struct fm_bank {
+    size_t count;
+    const struct fm_patch * patch;
+
+    /* the routing of the patch as gains, into each operator from each, and to the output, and its
+     levels and feedback within their bounds, the latter halved as it is of the mean of two outputs */
+    float route[FM_OPERATORS][FM_OPERATORS], carrier[FM_OPERATORS];
+    float level[FM_OPERATORS], feedback[FM_OPERATORS];
+
+    /* per operator, then per voice, the phase and increment, the amplitude and the coefficients of
+     its recurrence in the current block, the last two outputs, and the stage of its envelope */
+    uint32_t phase[FM_OPERATORS][FM_BANK_MAX], increment[FM_OPERATORS][FM_BANK_MAX];
+    float amplitude[FM_OPERATORS][FM_BANK_MAX], factor[FM_OPERATORS][FM_BANK_MAX], step[FM_OPERATORS][FM_BANK_MAX];
+    float output[FM_OPERATORS][FM_BANK_MAX], previous[FM_OPERATORS][FM_BANK_MAX];
+    enum envelope_stage stage[FM_OPERATORS][FM_BANK_MAX];
+    size_t stage_remaining[FM_OPERATORS][FM_BANK_MAX];
+
+    /* per voice, the amplitude of the note */
+    float peak[FM_BANK_MAX];
+
+    /* operators of all voices in the attack, decay or release of their envelopes */
+    size_t moving;
+};
+
+/* the patch must outlive the bank, and its envelopes are read when stages start */
+void fm_bank_init(struct fm_bank * bank, const struct fm_patch * patch);
+
+/* adds a silent voice, and returns its index, or FM_BANK_MAX if the bank is full */
+size_t fm_bank_add(struct fm_bank * bank);
+
+/* starts a note on a voice, with frequency in cycles per sample, in double so that the increment
+ of each operator can be rounded from it exactly, and with the attacks of the envelopes starting
+ from wherever they are. the phases restart only if the voice was silent, so a retrigger does not
+ click. the peak of each carrier is its level times the amplitude, and of each modulator its level */
+void fm_note_on(struct fm_bank * bank, const size_t ivoice, const double frequency, const float amplitude);
+
+/* starts the releases of the envelopes of every operator of a voice */
+void fm_note_off(struct fm_bank * bank, const size_t ivoice);
+
+/* whether every carrier of a voice is idle, so that it is silent, and need not be rendered */
+int fm_voice_idle(const struct fm_bank * bank, const size_t ivoice);
+
+/* writes count samples of the sum of the voices to dst */
+void fm_bank_render(struct fm_bank * bank, float * dst, const size_t count);
+
+#endif
@@ -0,0 +1,59 @@
+#include "interp_host.h"
+
+interp_hw_t interp_hw_array[2];
+
+interp_config interp_default_config(void) {
+    /* as the sdk's default: no shift, and all 32 bits unmasked */
+    return (interp_config) { .mask_msb = 31 };
+}
+
+void interp_config_set_shift(interp_config * c, const unsigned shift) {
+    c->shift = shift;
+}
+
+void interp_config_set_mask(interp_config * c, const unsigned mask_lsb, const unsigned mask_msb) {
+    c->mask_lsb = mask_lsb;
+    c->mask_msb = mask_msb;
+}
+
+void interp_config_set_cross_input(interp_config * c, const bool cross_input) {
+    c->cross_input = cross_input;
+}
+
+void interp_config_set_add_raw(interp_config * c, const bool add_raw) {
+    c->add_raw = add_raw;
+}
+
+void interp_set_config(interp_hw_t * interp, const unsigned lane, const interp_config * config) {
+    interp->config[lane] = *config;
+}
+
+void interp_set_base(interp_hw_t * interp, const unsigned lane, const uint32_t value) {
+    interp->base[lane] = value;
+}
+
+void interp_set_accumulator(interp_hw_t * interp, const unsigned lane, const uint32_t value) {
+    interp->accum[lane] = value;
+}
+
+uint32_t interp_get_accumulator(interp_hw_t * interp, const unsigned lane) {
+    return interp->accum[lane];
+}
+
+static uint32_t lane_result(const interp_hw_t * interp, const unsigned lane) {
+    const interp_config * const c = interp->config + lane;
+    const uint32_t input = interp->accum[c->cross_input ? !lane : lane];
+    const uint32_t mask = (0xFFFFFFFFU >> (31 - c->mask_msb)) & (0xFFFFFFFFU << c->mask_lsb);
+    return interp->base[lane] + (c->add_raw ? input : (input >> c->shift) & mask);
+}
+
+uint32_t interp_peek_lane_result(interp_hw_t * interp, const unsigned lane) {
+    return lane_result(interp, lane);
+}
+
+uint32_t interp_pop_lane_result(interp_hw_t * interp, const unsigned lane) {
+    const uint32_t results[2] = { lane_result(interp, 0), lane_result(interp, 1) };
+    interp->accum[0] = results[0];
+    interp->accum[1] = results[1];
+    return results[lane];
+}
@@ -0,0 +1,40 @@
+#ifndef INTERP_HOST_H
+#define INTERP_HOST_H
+
+/* software emulation of the subset of the sdk's hardware_interp api which the wavetable kernels
+ use, for the host build, so the same kernels run unchanged and give bit-for-bit the same results.
+ each interpolator has two lanes, each of which takes its own accumulator, or with cross input the
+ other one's, shifts it right, masks it, and adds its base. popping a lane returns its result and
+ writes both results back to the accumulators */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct {
+    unsigned shift, mask_lsb, mask_msb;
+    bool cross_input, add_raw;
+} interp_config;
+
+typedef struct {
+    uint32_t accum[2], base[3];
+    interp_config config[2];
+} interp_hw_t;
+
+extern interp_hw_t interp_hw_array[2];
+#define interp0 (&interp_hw_array[0])
+#define interp1 (&interp_hw_array[1])
+
+interp_config interp_default_config(void);
+void interp_config_set_shift(interp_config * c, const unsigned shift);
+void interp_config_set_mask(interp_config * c, const unsigned mask_lsb, const unsigned mask_msb);
+void interp_config_set_cross_input(interp_config * c, const bool cross_input);
+void interp_config_set_add_raw(interp_config * c, const bool add_raw);
+
+void interp_set_config(interp_hw_t * interp, const unsigned lane, const interp_config * config);
+void interp_set_base(interp_hw_t * interp, const unsigned lane, const uint32_t value);
+void interp_set_accumulator(interp_hw_t * interp, const unsigned lane, const uint32_t value);
+uint32_t interp_get_accumulator(interp_hw_t * interp, const unsigned lane);
+uint32_t interp_peek_lane_result(interp_hw_t * interp, const unsigned lane);
+uint32_t interp_pop_lane_result(interp_hw_t * interp, const unsigned lane);
+
+#endif
@@ -0,0 +1,51 @@
+#include "interpolate.h"
+
+#include <math.h>
+
+/* cutoff of the prototype, as a fraction of the nyquist of the input */
+#define CUTOFF 0.9
+
+void interpolator_init(struct interpolator * interpolator, const unsigned factor) {
+    *interpolator = (struct interpolator) { .factor = factor < INTERPOLATOR_FACTORS ? factor : INTERPOLATOR_FACTORS };
+    const unsigned length = interpolator->factor * INTERPOLATOR_TAPS_PER_PHASE;
+
+    for (unsigned iphase = 0; iphase < interpolator->factor; iphase++) {
+        double sum = 0.0;
+        for (unsigned itap = 0; itap < INTERPOLATOR_TAPS_PER_PHASE; itap++) {
+            /* output phase iphase uses prototype taps iphase, iphase + factor, ... against inputs
+             from newest to oldest, with the prototype centred between its two middle taps */
+            const unsigned n = iphase + itap * interpolator->factor;
+            const double t = n - (length - 1) / 2.0;
+            const double x = t * CUTOFF / interpolator->factor;
+            const double sinc = fabs(x) < 1e-9 ? 1.0 : sin(M_PI * x) / (M_PI * x);
+            const double window = 0.42 - 0.5 * cos(2.0 * M_PI * (n + 0.5) / length) + 0.08 * cos(4.0 * M_PI * (n + 0.5) / length);
+
+            interpolator->coefficients[iphase][itap] = sinc * window;
+            sum += sinc * window;
+        }
+
+        /* normalize each phase to unity gain at dc, which makes up for the zero stuffing, and
+         avoids a residual image of dc at multiples of the input rate */
+        for (unsigned itap = 0; itap < INTERPOLATOR_TAPS_PER_PHASE; itap++)
+            interpolator->coefficients[iphase][itap] /= sum;
+    }
+}
+
+void interpolate(struct interpolator * interpolator, float * dst, const float * src, const size_t count) {
+    const unsigned factor = interpolator->factor;
+    float * const history = interpolator->history;
+
+    for (size_t ival = 0; ival < count; ival++) {
+        for (size_t itap = INTERPOLATOR_TAPS_PER_PHASE - 1; itap; itap--)
+            history[itap] = history[itap - 1];
+        history[0] = src[ival];
+
+        for (unsigned iphase = 0; iphase < factor; iphase++) {
+            const float * const coefficients = interpolator->coefficients[iphase];
+            float sum = 0.0f;
+            for (size_t itap = 0; itap < INTERPOLATOR_TAPS_PER_PHASE; itap++)
+                sum += coefficients[itap] * history[itap];
+            *(dst++) = sum;
+        }
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef INTERPOLATE_H
+#define INTERPOLATE_H
+
+/* polyphase fir interpolation by an integer factor, from the synthesis rate up to the pwm rate when
+ oversampling. the prototype is a blackman-windowed sinc, cut off a little below the nyquist of the
+ input, so images of the input spectrum are pushed up around multiples of the input rate, well
+ clear of the audio band, and the analog filter only has to deal with the pwm carrier */
+
+#include <stddef.h>
+
+#define INTERPOLATOR_FACTOR_MAX 32
+
+/* the factor each interpolator has room for, which by default is any, and which the firmware cuts
+ down to its OVERSAMPLING */
+#ifndef INTERPOLATOR_FACTORS
+#define INTERPOLATOR_FACTORS INTERPOLATOR_FACTOR_MAX
+#endif
+
+_Static_assert(INTERPOLATOR_FACTORS >= 1 && INTERPOLATOR_FACTORS <= INTERPOLATOR_FACTOR_MAX, "factor of 1 to 32");
+
+/* cost is one multiply-accumulate per tap per output sample */
+#define INTERPOLATOR_TAPS_PER_PHASE 8
+
+struct interpolator {
+    unsigned factor;
+
+    /* indexed by phase, then tap */
+    float coefficients[INTERPOLATOR_FACTORS][INTERPOLATOR_TAPS_PER_PHASE];
+
+    /* most recent input first */
+    float history[INTERPOLATOR_TAPS_PER_PHASE];
+};
+
+void interpolator_init(struct interpolator * interpolator, const unsigned factor);
+
+/* writes count * factor output samples */
+void interpolate(struct interpolator * interpolator, float * dst, const float * src, const size_t count);
+
+#endif
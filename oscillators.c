@@ -0,0 +1,335 @@
+#include "oscillators.h"
+
+#include <math.h>
+
+void oscillator_bank_init(struct oscillator_bank * bank, const size_t renormalize_interval, const size_t lanes) {
+    bank->count = 0;
+    bank->renormalize_interval = renormalize_interval;
+    bank->since_renormalized = 0;
+    bank->lanes = !lanes ? 1 : lanes > OSCILLATOR_BANK_LANES ? OSCILLATOR_BANK_LANES : lanes;
+    bank->next_lane = 0;
+    bank->gliding = 0;
+    bank->envelope = NULL;
+    bank->enveloping = 0;
+}
+
+size_t oscillator_bank_add(struct oscillator_bank * bank, const float frequency, const float amplitude) {
+    if (bank->count >= OSCILLATOR_BANK_VOICES) return OSCILLATOR_BANK_MAX;
+
+    const size_t ivoice = bank->count++, lanes = bank->lanes;
+
+    /* lane k starts k samples ahead, joining in wherever the other voices are in their group */
+    for (size_t ilane = 0; ilane < lanes; ilane++) {
+        const long offset = (long)ilane - (long)bank->next_lane;
+        bank->re[ivoice * lanes + ilane] = 1 == lanes ? -1.0f : -cos(2.0 * M_PI * frequency * offset);
+        bank->im[ivoice * lanes + ilane] = 1 == lanes ? 0.0f : -sin(2.0 * M_PI * frequency * offset);
+    }
+    bank->advance_re[ivoice] = cosf(2.0f * (float)M_PI * frequency * lanes);
+    bank->advance_im[ivoice] = sinf(2.0f * (float)M_PI * frequency * lanes);
+    bank->amplitude[ivoice] = amplitude;
+    bank->frequency[ivoice] = frequency;
+    bank->amplitude_factor[ivoice] = 1.0f;
+    bank->amplitude_step[ivoice] = 0.0f;
+    bank->glide_remaining[ivoice] = 0;
+    bank->stage[ivoice] = ENVELOPE_IDLE;
+    if (bank->envelope) bank->amplitude[ivoice] = 0.0f;
+    return ivoice;
+}
+
+static void set_frequency(struct oscillator_bank * bank, const size_t ivoice, const float frequency) {
+    const size_t lanes = bank->lanes, next_lane = bank->next_lane;
+    const float are = cosf(2.0f * (float)M_PI * frequency), aim = sinf(2.0f * (float)M_PI * frequency);
+
+    /* the advance over all lanes */
+    float lanes_re = are, lanes_im = aim;
+    for (size_t ilane = 1; ilane < lanes; ilane++) {
+        const float next_re = lanes_re * are - lanes_im * aim;
+        lanes_im = lanes_re * aim + lanes_im * are;
+        lanes_re = next_re;
+    }
+    bank->advance_re[ivoice] = lanes_re;
+    bank->advance_im[ivoice] = lanes_im;
+
+    /* the lanes after the next one to be used are the samples after it, at the new frequency, and
+     those before it, which have been used in this group, are the same less the advance over all
+     lanes, so that after it they are again the samples after the others */
+    float * const vre = bank->re + ivoice * lanes, * const vim = bank->im + ivoice * lanes;
+    float re = vre[next_lane], im = vim[next_lane];
+    for (size_t m = 1; m < lanes; m++) {
+        const float next_re = re * are - im * aim;
+        im = re * aim + im * are;
+        re = next_re;
+
+        const size_t ilane = (next_lane + m) % lanes;
+        vre[ilane] = ilane > next_lane ? re : re * lanes_re + im * lanes_im;
+        vim[ilane] = ilane > next_lane ? im : im * lanes_re - re * lanes_im;
+    }
+
+    bank->frequency[ivoice] = frequency;
+}
+
+void oscillator_bank_retune(struct oscillator_bank * bank, const size_t ivoice, const float frequency, const float amplitude,
+                            const size_t samples, const enum oscillator_glide glide) {
+    if (ivoice >= bank->count) return;
+
+    if (bank->glide_remaining[ivoice]) bank->gliding--;
+    bank->glide_remaining[ivoice] = 0;
+
+    /* with an envelope, the amplitude is its business */
+    if (!bank->envelope) {
+        bank->amplitude_step[ivoice] = 0.0f;
+        if (!samples) bank->amplitude[ivoice] = amplitude;
+    }
+
+    if (!samples) {
+        set_frequency(bank, ivoice, frequency);
+        return;
+    }
+
+    bank->frequency_target[ivoice] = frequency;
+    bank->amplitude_target[ivoice] = amplitude;
+    bank->glide_samples[ivoice] = samples;
+    bank->glide[ivoice] = glide;
+    bank->glide_remaining[ivoice] = OSCILLATOR_GLIDE == glide ? samples * OSCILLATOR_GLIDE_TIME_CONSTANTS : samples;
+    bank->gliding++;
+}
+
+static float stage_target(const struct oscillator_bank * bank, const size_t ivoice) {
+    return envelope_target(bank->envelope, bank->stage[ivoice], bank->peak[ivoice]);
+}
+
+static void start_stage(struct oscillator_bank * bank, const size_t ivoice, const enum envelope_stage stage) {
+    bank->enveloping += envelope_start(bank->envelope, stage, bank->peak[ivoice], bank->stage + ivoice, bank->stage_remaining + ivoice,
+                                       bank->amplitude + ivoice, bank->amplitude_factor + ivoice, bank->amplitude_step + ivoice);
+}
+
+void oscillator_bank_envelope(struct oscillator_bank * bank, const struct envelope * envelope) {
+    bank->envelope = envelope;
+    bank->enveloping = 0;
+    for (size_t ivoice = 0; ivoice < bank->count; ivoice++) {
+        bank->stage[ivoice] = ENVELOPE_IDLE;
+        bank->amplitude_factor[ivoice] = 1.0f;
+        bank->amplitude_step[ivoice] = 0.0f;
+        if (envelope) bank->amplitude[ivoice] = 0.0f;
+    }
+}
+
+void oscillator_bank_attack(struct oscillator_bank * bank, const size_t ivoice, const float peak) {
+    if (!bank->envelope || ivoice >= bank->count) return;
+    bank->peak[ivoice] = peak;
+    start_stage(bank, ivoice, ENVELOPE_ATTACK);
+}
+
+void oscillator_bank_release(struct oscillator_bank * bank, const size_t ivoice) {
+    if (!bank->envelope || ivoice >= bank->count || ENVELOPE_IDLE == bank->stage[ivoice]) return;
+    start_stage(bank, ivoice, ENVELOPE_RELEASE);
+}
+
+static size_t glide_segment(struct oscillator_bank * bank, const size_t count) {
+    /* the segment ends no later than the first glide or stage to finish, so each ramp ends exactly */
+    size_t segment = count < OSCILLATOR_GLIDE_SEGMENT ? count : OSCILLATOR_GLIDE_SEGMENT;
+    for (size_t ivoice = 0; ivoice < bank->count; ivoice++) {
+        if (bank->glide_remaining[ivoice] && bank->glide_remaining[ivoice] < segment)
+            segment = bank->glide_remaining[ivoice];
+        if (bank->envelope && envelope_moving(bank->stage[ivoice]) && bank->stage_remaining[ivoice] < segment)
+            segment = bank->stage_remaining[ivoice];
+    }
+
+    for (size_t ivoice = 0; ivoice < bank->count; ivoice++) {
+        if (bank->envelope && envelope_moving(bank->stage[ivoice]))
+            envelope_coefficients(bank->envelope, bank->stage[ivoice], bank->amplitude[ivoice], stage_target(bank, ivoice),
+                                  bank->stage_remaining[ivoice], bank->amplitude_factor + ivoice, bank->amplitude_step + ivoice);
+
+        const size_t remaining = bank->glide_remaining[ivoice];
+        if (!remaining) continue;
+
+        const float frequency = bank->frequency[ivoice], target = bank->frequency_target[ivoice];
+        const float amplitude = bank->amplitude[ivoice], amplitude_target = bank->amplitude_target[ivoice];
+        float mean, end, amplitude_end;
+
+        if (OSCILLATOR_RAMP == bank->glide[ivoice]) {
+            /* the k-th sample from here advances by frequency + k (target - frequency) / remaining,
+             for k from 1, and the mean of those over the segment makes the phase exact at its end */
+            const float step = (target - frequency) / remaining;
+            mean = frequency + step * (segment + 1) / 2.0f;
+            end = frequency + step * segment;
+            amplitude_end = amplitude + (amplitude_target - amplitude) * segment / remaining;
+        }
+        else {
+            /* exponentially, by pitch if the frequencies have the same sign, else linearly */
+            const float tau = bank->glide_samples[ivoice];
+            const float decay = expf(-(float)segment / tau), half_decay = expf(-0.5f * segment / tau);
+            if (frequency * target > 0.0f) {
+                const float ratio = logf(frequency / target);
+                mean = target * expf(ratio * half_decay);
+                end = target * expf(ratio * decay);
+            } else {
+                mean = target + (frequency - target) * half_decay;
+                end = target + (frequency - target) * decay;
+            }
+            amplitude_end = amplitude_target + (amplitude - amplitude_target) * decay;
+        }
+
+        /* the last segment ends on the targets */
+        if (remaining == segment) {
+            end = target;
+            amplitude_end = amplitude_target;
+        }
+
+        set_frequency(bank, ivoice, mean);
+        bank->frequency[ivoice] = end;
+        if (!bank->envelope) bank->amplitude_step[ivoice] = (amplitude_end - amplitude) / segment;
+    }
+
+    return segment;
+}
+
+static void glide_segment_end(struct oscillator_bank * bank, const size_t segment) {
+    for (size_t ivoice = 0; ivoice < bank->count; ivoice++) {
+        if (bank->envelope && envelope_moving(bank->stage[ivoice]))
+            bank->enveloping += envelope_advance(bank->envelope, segment, bank->peak[ivoice], bank->stage + ivoice,
+                                                 bank->stage_remaining + ivoice, bank->amplitude + ivoice,
+                                                 bank->amplitude_factor + ivoice, bank->amplitude_step + ivoice);
+
+        if (!bank->glide_remaining[ivoice]) continue;
+
+        bank->glide_remaining[ivoice] -= segment;
+        if (!bank->glide_remaining[ivoice]) {
+            /* land exactly on the targets, with the advance of the final frequency */
+            set_frequency(bank, ivoice, bank->frequency_target[ivoice]);
+            if (!bank->envelope) {
+                bank->amplitude[ivoice] = bank->amplitude_target[ivoice];
+                bank->amplitude_step[ivoice] = 0.0f;
+            }
+            bank->gliding--;
+        }
+    }
+}
+
+static void renormalize(struct oscillator_bank * bank) {
+    for (size_t ivoice = 0; ivoice < bank->count * bank->lanes; ivoice++) {
+        const float gain = (3.0f - (bank->re[ivoice] * bank->re[ivoice] + bank->im[ivoice] * bank->im[ivoice])) / 2.0f;
+        bank->re[ivoice] *= gain;
+        bank->im[ivoice] *= gain;
+    }
+}
+
+__attribute((always_inline))
+static inline void advance_lanes(struct oscillator_bank * bank, const size_t lanes, const int renormalize) {
+    /* every lane of every voice is an independent chain, and with lanes known at compile time the
+     inner loop is unrolled, so that the rotations of the lanes of one voice are interleaved */
+    float * const restrict vre = bank->re, * const restrict vim = bank->im;
+
+    for (size_t ivoice = 0; ivoice < bank->count; ivoice++) {
+        const float are = bank->advance_re[ivoice], aim = bank->advance_im[ivoice];
+        for (size_t ilane = 0; ilane < lanes; ilane++) {
+            const size_t i = ivoice * lanes + ilane;
+            const float next_re = vre[i] * are - vim[i] * aim;
+            const float next_im = vre[i] * aim + vim[i] * are;
+
+            const float gain = renormalize ? (3.0f - (next_re * next_re + next_im * next_im)) / 2.0f : 1.0f;
+            vre[i] = next_re * gain;
+            vim[i] = next_im * gain;
+        }
+    }
+}
+
+static void advance_all_lanes(struct oscillator_bank * bank, const int renormalize) {
+    switch (bank->lanes) {
+        case 2: advance_lanes(bank, 2, renormalize); break;
+        case 4: advance_lanes(bank, 4, renormalize); break;
+        case 8: advance_lanes(bank, 8, renormalize); break;
+        default: advance_lanes(bank, bank->lanes, renormalize);
+    }
+}
+
+static void render_lanes(struct oscillator_bank * bank, float * re, float * im, const size_t count, const int ramp) {
+    const size_t voices = bank->count, lanes = bank->lanes, interval = bank->renormalize_interval;
+
+    for (size_t ival = 0; ival < count; ival++) {
+        /* each sample is the sum of one lane of each voice */
+        const size_t ilane = bank->next_lane;
+        float sum_re = 0.0f, sum_im = 0.0f;
+        for (size_t ivoice = 0; ivoice < voices; ivoice++) {
+            sum_re += bank->re[ivoice * lanes + ilane] * bank->amplitude[ivoice];
+            sum_im += bank->im[ivoice * lanes + ilane] * bank->amplitude[ivoice];
+            if (ramp) bank->amplitude[ivoice] = bank->amplitude[ivoice] * bank->amplitude_factor[ivoice] + bank->amplitude_step[ivoice];
+        }
+
+        re[ival] = sum_re;
+        if (im) im[ival] = sum_im;
+
+        /* once every lane has been used, advance them all to the next group of samples */
+        if (++bank->next_lane == lanes) {
+            bank->next_lane = 0;
+            bank->since_renormalized += lanes;
+            const int renormalize = interval && bank->since_renormalized >= interval;
+            if (renormalize) bank->since_renormalized = 0;
+            advance_all_lanes(bank, renormalize);
+        }
+    }
+
+    if (!interval) renormalize(bank);
+}
+
+void oscillator_bank_render(struct oscillator_bank * bank, float * re, float * im, const size_t count) {
+    if (bank->gliding || bank->enveloping) {
+        /* in segments, with the amplitudes ramped per sample, and once nothing glides or moves
+         along its envelope any more, the rest as usual */
+        size_t ival = 0;
+        while ((bank->gliding || bank->enveloping) && ival < count) {
+            const size_t segment = glide_segment(bank, count - ival);
+            render_lanes(bank, re + ival, im ? im + ival : NULL, segment, 1);
+            glide_segment_end(bank, segment);
+            ival += segment;
+        }
+
+        if (ival < count) oscillator_bank_render(bank, re + ival, im ? im + ival : NULL, count - ival);
+        return;
+    }
+
+    if (bank->lanes > 1) {
+        render_lanes(bank, re, im, count, 0);
+        return;
+    }
+
+    const size_t voices = bank->count, interval = bank->renormalize_interval;
+    float * const restrict vre = bank->re, * const restrict vim = bank->im;
+    const float * const restrict are = bank->advance_re, * const restrict aim = bank->advance_im;
+    const float * const restrict amplitude = bank->amplitude;
+
+    for (size_t ival = 0; ival < count; ival++) {
+        float sum_re = 0.0f, sum_im = 0.0f;
+
+        if (interval && ++bank->since_renormalized >= interval) {
+            bank->since_renormalized = 0;
+
+            for (size_t ivoice = 0; ivoice < voices; ivoice++) {
+                sum_re += vre[ivoice] * amplitude[ivoice];
+                sum_im += vim[ivoice] * amplitude[ivoice];
+
+                /* rotate complex sinusoid at the desired frequency */
+                const float next_re = vre[ivoice] * are[ivoice] - vim[ivoice] * aim[ivoice];
+                const float next_im = vre[ivoice] * aim[ivoice] + vim[ivoice] * are[ivoice];
+
+                /* renormalize to unity */
+                const float gain = (3.0f - (next_re * next_re + next_im * next_im)) / 2.0f;
+                vre[ivoice] = next_re * gain;
+                vim[ivoice] = next_im * gain;
+            }
+        } else
+            for (size_t ivoice = 0; ivoice < voices; ivoice++) {
+                sum_re += vre[ivoice] * amplitude[ivoice];
+                sum_im += vim[ivoice] * amplitude[ivoice];
+
+                const float next_re = vre[ivoice] * are[ivoice] - vim[ivoice] * aim[ivoice];
+                vim[ivoice] = vre[ivoice] * aim[ivoice] + vim[ivoice] * are[ivoice];
+                vre[ivoice] = next_re;
+            }
+
+        re[ival] = sum_re;
+        if (im) im[ival] = sum_im;
+    }
+
+    if (!interval) renormalize(bank);
+}
@@ -0,0 +1,141 @@
+#ifndef OSCILLATORS_H
+#define OSCILLATORS_H
+
+/* a bank of independent complex phasors, each rotated by its own advance every sample and scaled
+ by its own amplitude, whose real parts are summed. the state is kept as a structure of arrays,
+ and each sample loops over all voices, so that the rotations of different voices, which do not
+ depend on each other, can be interleaved to keep the fpu pipeline full, rather than each waiting
+ on the result of its own previous rotation.
+
+ with only a few voices, that is not enough to hide the latency of each rotation, so each voice can
+ instead be split into lanes: K phasors a sample apart, each advanced by the K-th power of the
+ advance once every K samples, so that even a single voice has K independent dependency chains */
+
+#include <stddef.h>
+
+#include "envelope.h"
+
+#define OSCILLATOR_BANK_MAX 128
+
+/* while any voice glides, or is in the attack, decay or release of its envelope, the bank is
+ rendered in segments of at most this many samples, before each of which the advance of each
+ gliding voice is recomputed, for the mean of its frequency over the segment, so that the phase is
+ exact at the end of each segment. its amplitude is ramped linearly over each segment, exactly so
+ for a linear ramp, or follows its envelope */
+#define OSCILLATOR_GLIDE_SEGMENT 32
+
+/* an exponential glide is snapped to its target after as many time constants as an envelope */
+#define OSCILLATOR_GLIDE_TIME_CONSTANTS ENVELOPE_TIME_CONSTANTS
+
+enum oscillator_glide {
+    /* linearly, reaching the target after the given number of samples */
+    OSCILLATOR_RAMP,
+
+    /* exponentially, by pitch, i.e. by the logarithm of the frequency, and by amplitude, covering
+     all but 1 / e of the remaining way every given number of samples */
+    OSCILLATOR_GLIDE,
+};
+
+/* how often to pull each phasor back to unit magnitude, in samples, or 0 for once per call to
+ oscillator_bank_render(), which is once per chunk unless events split it into sub-blocks, each a
+ call of its own, and while anything glides or moves along its envelope, once per segment, see
+ below. so it is at least once per chunk. each rotation in float changes the magnitude by a
+ relative error of at most a few ulp, i.e. 2^-23 or so, mostly a consistent bias from the rounding
+ of the advance, so the error grows about linearly between renormalizations, by at most
+ OSCILLATOR_DRIFT_PER_SAMPLE per sample. the renormalization is a newton step, which leaves an
+ error e as about 3/2 e^2, so it fully recovers from any error up to well over 1e-3. for an
+ amplitude error below 2^-16, i.e. under one level of 16-bit output, an interval of up to 64 will
+ do, and once per call of up to 1024 samples stays within 2^-12, which is still below one level at TOP 1024.
+ renormalizing per sample roughly doubles the arithmetic per voice */
+#ifndef OSCILLATOR_RENORMALIZE_INTERVAL
+#define OSCILLATOR_RENORMALIZE_INTERVAL 1
+#endif
+
+#define OSCILLATOR_DRIFT_PER_SAMPLE 2.4e-7f
+
+/* lanes per voice, which are unrolled for 2, 4 and 8, the first of which is enough to hide the
+ latency of the fpu of the cortex-m33 */
+#define OSCILLATOR_LANES_MAX 8
+
+#ifndef OSCILLATOR_LANES
+#define OSCILLATOR_LANES 1
+#endif
+
+/* the voices and lanes each bank has room for, which by default is any number of either, and which
+ the firmware cuts down to the VOICES and OSCILLATOR_LANES it plays */
+#ifndef OSCILLATOR_BANK_VOICES
+#define OSCILLATOR_BANK_VOICES OSCILLATOR_BANK_MAX
+#endif
+
+#ifndef OSCILLATOR_BANK_LANES
+#define OSCILLATOR_BANK_LANES OSCILLATOR_LANES_MAX
+#endif
+
+_Static_assert(OSCILLATOR_BANK_VOICES <= OSCILLATOR_BANK_MAX && OSCILLATOR_BANK_LANES <= OSCILLATOR_LANES_MAX,
+               "at most 128 voices of 8 lanes");
+
+struct oscillator_bank {
+    size_t count, renormalize_interval, since_renormalized;
+    size_t lanes, next_lane;
+
+    /* indexed by voice, then lane */
+    float re[OSCILLATOR_BANK_VOICES * OSCILLATOR_BANK_LANES], im[OSCILLATOR_BANK_VOICES * OSCILLATOR_BANK_LANES];
+
+    /* per voice, to the power of the number of lanes */
+    float advance_re[OSCILLATOR_BANK_VOICES], advance_im[OSCILLATOR_BANK_VOICES];
+    float amplitude[OSCILLATOR_BANK_VOICES];
+
+    /* per voice, the frequency in cycles per sample, and for gliding voices, the targets, the
+     samples left, and the time constant of an exponential glide */
+    float frequency[OSCILLATOR_BANK_VOICES];
+    float frequency_target[OSCILLATOR_BANK_VOICES], amplitude_target[OSCILLATOR_BANK_VOICES];
+    size_t glide_remaining[OSCILLATOR_BANK_VOICES], glide_samples[OSCILLATOR_BANK_VOICES];
+    enum oscillator_glide glide[OSCILLATOR_BANK_VOICES];
+
+    /* the envelope of every voice, or NULL for none, and per voice, its stage, the samples left in
+     it, and the peak of the note */
+    const struct envelope * envelope;
+    enum envelope_stage stage[OSCILLATOR_BANK_VOICES];
+    size_t stage_remaining[OSCILLATOR_BANK_VOICES];
+    float peak[OSCILLATOR_BANK_VOICES];
+
+    /* per voice, the amplitude of each sample within the current segment is that of the one
+     before times the factor plus the step */
+    float amplitude_factor[OSCILLATOR_BANK_VOICES], amplitude_step[OSCILLATOR_BANK_VOICES];
+
+    /* voices with samples left to glide, and in the attack, decay or release of their envelopes */
+    size_t gliding, enveloping;
+};
+
+/* interval is as for OSCILLATOR_RENORMALIZE_INTERVAL, and is rounded up to a multiple of the lanes,
+ which are as for OSCILLATOR_LANES */
+void oscillator_bank_init(struct oscillator_bank * bank, const size_t renormalize_interval, const size_t lanes);
+
+/* frequency is in cycles per sample, and the phase starts at pi, as the original carrier did.
+ returns the index of the new voice, or OSCILLATOR_BANK_MAX if the bank is full, at
+ OSCILLATOR_BANK_VOICES */
+size_t oscillator_bank_add(struct oscillator_bank * bank, const float frequency, const float amplitude);
+
+/* moves the frequency and amplitude of a voice from wherever they are to new targets, starting with
+ the next sample rendered, either ramping over the given number of samples or gliding with it as
+ the time constant, or immediately if it is 0. the phase is continuous throughout, so there is no
+ click, and the advance is recomputed once per segment rather than per sample */
+void oscillator_bank_retune(struct oscillator_bank * bank, const size_t ivoice, const float frequency, const float amplitude,
+                            const size_t samples, const enum oscillator_glide glide);
+
+/* gives every voice the same envelope, or none if NULL, in which case the amplitudes are as set
+ by oscillator_bank_retune(). with an envelope, retuning only changes the frequency, and the
+ envelope is played by oscillator_bank_attack() and oscillator_bank_release(). setting one
+ silences all voices, until their attacks */
+void oscillator_bank_envelope(struct oscillator_bank * bank, const struct envelope * envelope);
+
+/* starts the attack of a voice towards the given peak amplitude, from wherever its amplitude is,
+ followed by its decay and sustain, which holds until its release, down to silence */
+void oscillator_bank_attack(struct oscillator_bank * bank, const size_t ivoice, const float peak);
+void oscillator_bank_release(struct oscillator_bank * bank, const size_t ivoice);
+
+/* writes count samples of the sum of the real parts to re, and if im is not null, the same of the
+ imaginary parts, which are 90 degrees behind, to im */
+void oscillator_bank_render(struct oscillator_bank * bank, float * re, float * im, const size_t count);
+
+#endif
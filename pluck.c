@@ -0,0 +1,135 @@
+#include "pluck.h"
+#include "quantize.h"
+
+#include <math.h>
+
+/* the least delay the allpass is tuned for, below which its delay varies too much with frequency,
+ so that it covers [ALLPASS_MIN_DELAY, 1 + ALLPASS_MIN_DELAY) of the period */
+#define ALLPASS_MIN_DELAY 0.1
+
+void pluck_bank_init(struct pluck_bank * bank) {
+    bank->count = 0;
+    bank->arena_used = 0;
+}
+
+size_t pluck_bank_add(struct pluck_bank * bank, const double lowest) {
+    const size_t capacity = lowest > 0.0 ? (size_t)ceil(1.0 / lowest) : 0;
+    if (bank->count >= PLUCK_BANK_MAX || !capacity || capacity > PLUCK_ARENA_SAMPLES - bank->arena_used) return PLUCK_BANK_MAX;
+
+    const size_t istring = bank->count++;
+    bank->offset[istring] = bank->arena_used;
+    bank->capacity[istring] = capacity;
+    bank->arena_used += capacity;
+
+    bank->length[istring] = capacity;
+    bank->position[istring] = 0;
+    bank->period[istring] = capacity;
+    bank->gain[istring] = 0.0f;
+    bank->coefficient[istring] = 0.0f;
+    bank->last[istring] = 0.0f;
+    bank->allpass_in[istring] = 0.0f;
+    bank->allpass_out[istring] = 0.0f;
+    bank->remaining[istring] = 0;
+
+    for (size_t ival = 0; ival < capacity; ival++)
+        bank->arena[bank->offset[istring] + ival] = 0.0f;
+    return istring;
+}
+
+static float gain_per_period(const double period, const size_t decay) {
+    /* down by 60 dB after decay samples, which is decay / period trips around the loop */
+    return decay ? pow(10.0, -3.0 * period / decay) : 0.0f;
+}
+
+void pluck(struct pluck_bank * bank, const size_t istring, const double frequency, const float amplitude, const size_t decay,
+           const float brightness) {
+    if (istring >= bank->count || frequency <= 0.0) return;
+
+    /* the period is the line, half a sample for the loss filter, and the rest for the allpass */
+    const double period = 1.0 / frequency;
+    double whole = floor(period - 0.5 - ALLPASS_MIN_DELAY);
+    if (whole < 1.0) whole = 1.0;
+    if (whole > bank->capacity[istring]) whole = bank->capacity[istring];
+    const size_t length = whole;
+    const double delay = period - 0.5 - length;
+
+    /* the coefficient for which the phase delay of the allpass is exactly delay at the fundamental */
+    const double w = 2.0 * M_PI * frequency;
+    bank->coefficient[istring] = sin((1.0 - delay) * w / 2.0) / sin((1.0 + delay) * w / 2.0);
+
+    bank->length[istring] = length;
+    bank->position[istring] = 0;
+    bank->period[istring] = period;
+    bank->gain[istring] = gain_per_period(period, decay);
+    bank->last[istring] = 0.0f;
+    bank->allpass_in[istring] = 0.0f;
+    bank->allpass_out[istring] = 0.0f;
+    bank->remaining[istring] = PLUCK_SILENT_DECAYS * decay;
+
+    /* noise from the top 32 bits of the generator, smoothed by a one-pole lowpass for a softer
+     pluck, less its mean, so that the string carries no dc */
+    float * const line = bank->arena + bank->offset[istring];
+    const float b = brightness <= 0.0f ? 1.0f : brightness > 1.0f ? 1.0f : brightness;
+    float smoothed = 0.0f, sum = 0.0f;
+    for (size_t ival = 0; ival < length; ival++) {
+        const float noise = (int32_t)(xorshift64star() >> 32) * (1.0f / 2147483648.0f);
+        smoothed += b * (noise - smoothed);
+        line[ival] = smoothed;
+        sum += smoothed;
+    }
+    for (size_t ival = 0; ival < length; ival++)
+        line[ival] = amplitude * (line[ival] - sum / length);
+}
+
+void pluck_damp(struct pluck_bank * bank, const size_t istring, const size_t decay) {
+    if (istring >= bank->count || !bank->remaining[istring]) return;
+    bank->gain[istring] = gain_per_period(bank->period[istring], decay);
+    if (bank->remaining[istring] > PLUCK_SILENT_DECAYS * decay)
+        bank->remaining[istring] = PLUCK_SILENT_DECAYS * decay;
+}
+
+static void render_string(struct pluck_bank * bank, const size_t istring, float * dst, const size_t count) {
+    float * const line = bank->arena + bank->offset[istring];
+    const size_t length = bank->length[istring];
+    const float half_gain = 0.5f * bank->gain[istring], c = bank->coefficient[istring];
+    size_t position = bank->position[istring];
+    float last = bank->last[istring], allpass_in = bank->allpass_in[istring], allpass_out = bank->allpass_out[istring];
+
+    /* in runs up to the wrap of the line, so that there is no test of the position per sample */
+    for (size_t ival = 0; ival < count; ) {
+        const size_t run = count - ival < length - position ? count - ival : length - position;
+        float * const restrict tap = line + position;
+        float * const restrict out = dst + ival;
+
+        for (size_t k = 0; k < run; k++) {
+            /* the sample one line ago is heard, and fed back through the loss filter and the allpass */
+            const float x = tap[k];
+            const float loss = half_gain * (x + last);
+            allpass_out = c * (loss - allpass_out) + allpass_in;
+            allpass_in = loss;
+            last = x;
+            tap[k] = allpass_out;
+            out[k] += x;
+        }
+
+        ival += run;
+        position += run;
+        if (position == length) position = 0;
+    }
+
+    bank->position[istring] = position;
+    bank->last[istring] = last;
+    bank->allpass_in[istring] = allpass_in;
+    bank->allpass_out[istring] = allpass_out;
+}
+
+void pluck_bank_render(struct pluck_bank * bank, float * dst, const size_t count) {
+    for (size_t ival = 0; ival < count; ival++)
+        dst[ival] = 0.0f;
+
+    for (size_t istring = 0; istring < bank->count; istring++) {
+        if (!bank->remaining[istring]) continue;
+        render_string(bank, istring, dst, count);
+        bank->remaining[istring] = bank->remaining[istring] > count ? bank->remaining[istring] - count : 0;
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef PLUCK_H
+#define PLUCK_H
+
+/* plucked strings by the karplus-strong algorithm: each string is a delay line of one period,
+ filled with a burst of noise from xorshift64star() when plucked, whose output is fed back into it
+ through a loss filter, the mean of two successive samples times a gain per period, which sets the
+ decay, and which takes the higher harmonics down faster, as in a real string. the loss filter
+ delays by half a sample, and the rest of the period beyond a whole number of samples is made up
+ by a first-order allpass, tuned to have exactly that delay at the fundamental, so the pitch is
+ exact, rather than rounded to the nearest period in samples.
+
+ the delay lines of all strings live in one fixed arena in the bank, each a contiguous slice long
+ enough for the lowest note it is added for, reserved once when it is added, so there is no
+ allocation at run time. a note only touches the first period of its slice, so the working set of
+ a bank is the sum of the periods of the notes sounding, and each string is rendered on its own
+ in runs up to the wrap of its line, with its state in registers. strings which have decayed to
+ silence are skipped */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define PLUCK_BANK_MAX 32
+
+/* samples of delay line per bank, shared by its strings, each needing a little over one period of
+ its lowest note, e.g. 852 samples for 55 Hz at 46875 Hz, and which the firmware cuts down to its
+ VOICES strings at the lowest note of its pattern */
+#ifndef PLUCK_ARENA_SAMPLES
+#define PLUCK_ARENA_SAMPLES 8192
+#endif
+
+/* a string is skipped once this much of its decay to -60 dB has gone by, which is -120 dB */
+#define PLUCK_SILENT_DECAYS 2
+
+struct pluck_bank {
+    size_t count, arena_used;
+
+    /* per string, the offset and size of its slice of the arena, its length in use and position
+     within it, its period in samples, the gain per period of the loss filter, the coefficient of
+     the allpass, the state of both filters, and the samples left until it is silent */
+    size_t offset[PLUCK_BANK_MAX], capacity[PLUCK_BANK_MAX], length[PLUCK_BANK_MAX], position[PLUCK_BANK_MAX];
+    float period[PLUCK_BANK_MAX], gain[PLUCK_BANK_MAX], coefficient[PLUCK_BANK_MAX];
+    float last[PLUCK_BANK_MAX], allpass_in[PLUCK_BANK_MAX], allpass_out[PLUCK_BANK_MAX];
+    size_t remaining[PLUCK_BANK_MAX];
+
+    float arena[PLUCK_ARENA_SAMPLES];
+};
+
+void pluck_bank_init(struct pluck_bank * bank);
+
+/* adds a silent string which can play down to the lowest frequency, in cycles per sample, and
+ returns its index, or PLUCK_BANK_MAX if the bank or its arena is full */
+size_t pluck_bank_add(struct pluck_bank * bank, const double lowest);
+
+/* plucks a string at frequency, in cycles per sample, no lower than that it was added for, with
+ a burst of noise of the given amplitude, decaying to -60 dB over decay samples. brightness, in
+ (0, 1], is the fraction of the noise left unsmoothed, lower being a softer pluck */
+void pluck(struct pluck_bank * bank, const size_t istring, const double frequency, const float amplitude, const size_t decay,
+           const float brightness);
+
+/* shortens the decay of a sounding string, from now, as a hand damping it would */
+void pluck_damp(struct pluck_bank * bank, const size_t istring, const size_t decay);
+
+/* writes count samples of the sum of the strings to dst */
+void pluck_bank_render(struct pluck_bank * bank, float * dst, const size_t count);
+
+#endif
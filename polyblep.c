@@ -0,0 +1,92 @@
+#include "polyblep.h"
+
+#include <math.h>
+
+static float blep(const float t, const float dt) {
+    /* residual of a band-limited unit step at phase 0, within one sample either side, where t is
+     the phase in [0, 1) and dt the increment, both in cycles */
+    if (t < dt) {
+        const float d = 1.0f - t / dt;
+        return -0.5f * d * d;
+    }
+    if (t > 1.0f - dt) {
+        const float d = (t - 1.0f) / dt + 1.0f;
+        return 0.5f * d * d;
+    }
+    return 0.0f;
+}
+
+static float blamp(const float t, const float dt) {
+    /* residual of a band-limited corner at phase 0, whose slope rises by one per sample, the
+     integral of blep() */
+    if (t < dt) {
+        const float d = 1.0f - t / dt;
+        return d * d * d * (1.0f / 6.0f);
+    }
+    if (t > 1.0f - dt) {
+        const float d = (t - 1.0f) / dt + 1.0f;
+        return d * d * d * (1.0f / 6.0f);
+    }
+    return 0.0f;
+}
+
+void polyblep_bank_init(struct polyblep_bank * bank, const enum waveform waveform) {
+    bank->waveform = waveform;
+    bank->count = 0;
+}
+
+size_t polyblep_bank_add(struct polyblep_bank * bank, const double frequency, const float amplitude) {
+    if (bank->count >= POLYBLEP_BANK_MAX) return POLYBLEP_BANK_MAX;
+
+    const size_t ivoice = bank->count++;
+    bank->phase[ivoice] = 0;
+    bank->increment[ivoice] = (uint32_t)(int64_t)llround(frequency * 4294967296.0);
+    bank->amplitude[ivoice] = amplitude;
+    bank->width[ivoice] = 0.5f;
+    return ivoice;
+}
+
+void polyblep_set_width(struct polyblep_bank * bank, const size_t ivoice, const float width) {
+    const float dt = bank->increment[ivoice] * (1.0f / 4294967296.0f);
+    bank->width[ivoice] = width < dt ? dt : width > 1.0f - dt ? 1.0f - dt : width;
+}
+
+void polyblep_bank_render(struct polyblep_bank * bank, float * re, const size_t count) {
+    for (size_t ival = 0; ival < count; ival++)
+        re[ival] = 0.0f;
+
+    /* one voice at a time, with the choice of waveform made once per voice per chunk */
+    for (size_t ivoice = 0; ivoice < bank->count; ivoice++) {
+        const uint32_t increment = bank->increment[ivoice];
+        const float dt = increment * (1.0f / 4294967296.0f), amplitude = bank->amplitude[ivoice];
+        uint32_t phase = bank->phase[ivoice];
+
+        if (WAVEFORM_SQUARE == bank->waveform) {
+            /* rises by 2 at phase 0 and falls by 2 at the width, less its mean of 2 width - 1, so
+             that a narrow pulse rests at the same level as a square, rather than towards one end */
+            const float width = bank->width[ivoice], offset = 1.0f - 2.0f * width;
+            for (size_t ival = 0; ival < count; ival++) {
+                const float t = phase * (1.0f / 4294967296.0f), t_fall = t < width ? t - width + 1.0f : t - width;
+                re[ival] += ((t < width ? 1.0f : -1.0f) + offset + 2.0f * (blep(t, dt) - blep(t_fall, dt))) * amplitude;
+                phase += increment;
+            }
+        }
+        else if (WAVEFORM_TRIANGLE == bank->waveform) {
+            /* the slope rises by 8 per cycle at phase 0 and falls by 8 at half a cycle */
+            for (size_t ival = 0; ival < count; ival++) {
+                const float t = phase * (1.0f / 4294967296.0f), t_peak = t < 0.5f ? t + 0.5f : t - 0.5f;
+                re[ival] += (1.0f - 4.0f * fabsf(t - 0.5f) + 8.0f * dt * (blamp(t, dt) - blamp(t_peak, dt))) * amplitude;
+                phase += increment;
+            }
+        }
+        else
+            /* falls by 2 at phase 0 */
+            for (size_t ival = 0; ival < count; ival++) {
+                const float t = phase * (1.0f / 4294967296.0f);
+                re[ival] += (2.0f * t - 1.0f - 2.0f * blep(t, dt)) * amplitude;
+                phase += increment;
+            }
+
+        bank->phase[ivoice] = phase;
+    }
+}
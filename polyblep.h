@@ -0,0 +1,44 @@
+#ifndef POLYBLEP_H
+#define POLYBLEP_H
+
+/* classic waveforms by polyblep: each voice is a phase accumulator, as in dds.h, whose naive saw,
+ pulse or triangle is corrected within a sample either side of each discontinuity by a two-sample
+ polynomial approximation of the residual of a band-limited step, or for the corners of the
+ triangle, of its integral, a band-limited ramp. the aliases are not as low as from the tables of
+ wavetable.h, but there are no tables, only a few words of state per voice, and the pulse width
+ can be changed at any time, which tables cannot do */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "wavetable.h"
+
+#define POLYBLEP_BANK_MAX 128
+
+struct polyblep_bank {
+    enum waveform waveform;
+    size_t count;
+    uint32_t phase[POLYBLEP_BANK_MAX], increment[POLYBLEP_BANK_MAX];
+    float amplitude[POLYBLEP_BANK_MAX];
+
+    /* fraction of each cycle for which the pulse is high, 0.5 for a square */
+    float width[POLYBLEP_BANK_MAX];
+};
+
+/* all voices of a bank play the same waveform, a saw, square or triangle. a square is a pulse,
+ whose width can be set per voice, and which has no dc at any width, so that it spans 2 - 2 width
+ down to -2 width, and anything else is taken as a saw */
+void polyblep_bank_init(struct polyblep_bank * bank, const enum waveform waveform);
+
+/* as for dds_bank_add(), but the phase starts at 0, where the saw falls from 1 to -1, the pulse
+ rises from -1 to 1, and the triangle is at its lowest. returns the index of the new voice, or
+ POLYBLEP_BANK_MAX if full */
+size_t polyblep_bank_add(struct polyblep_bank * bank, const double frequency, const float amplitude);
+
+/* the width is clamped to within the increment of either edge, so the two edges of a pulse
+ never fall within the same sample */
+void polyblep_set_width(struct polyblep_bank * bank, const size_t ivoice, const float width);
+
+void polyblep_bank_render(struct polyblep_bank * bank, float * re, const size_t count);
+
+#endif
@@ -0,0 +1,171 @@
+#include "profile.h"
+#include "audio_out.h"
+#include "underrun.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+
+struct chunk_timing profile_ring[PROFILE_RING_LENGTH];
+
+/* histogram of fill time as a fraction of the chunk deadline, the last bin catches everything over */
+#define HISTOGRAM_BINS 11
+
+struct interval_stats {
+    uint32_t min, max;
+    uint64_t sum;
+};
+
+static struct {
+    struct interval_stats fill, idle, latency;
+    uint32_t histogram[HISTOGRAM_BINS];
+    size_t count, latency_count;
+} stats;
+
+static uint32_t deadline;
+
+/* the chunk most recently filled, as after an underrun the producer skips ahead, and then waits
+ after a chunk it did not fill, whose timestamps are from a lap or more before */
+static size_t last_filled;
+
+/* the report is formatted into a buffer all at once, and written out a few bytes per chunk, see
+ PROFILE_REPORT_BYTES_PER_SECOND */
+#define REPORT_SIZE 1024
+
+static char report[REPORT_SIZE];
+static size_t report_length, report_written, report_bytes_per_chunk;
+
+static const char * scale_name = "channels";
+static size_t scale_count = AUDIO_OUT_CHANNELS;
+
+static void interval_stats_reset(struct interval_stats * s) {
+    *s = (struct interval_stats) { .min = UINT32_MAX };
+}
+
+static void interval_stats_accumulate(struct interval_stats * s, const uint32_t value) {
+    if (value < s->min) s->min = value;
+    if (value > s->max) s->max = value;
+    s->sum += value;
+}
+
+static void stats_reset(void) {
+    interval_stats_reset(&stats.fill);
+    interval_stats_reset(&stats.idle);
+    interval_stats_reset(&stats.latency);
+    for (size_t ibin = 0; ibin < HISTOGRAM_BINS; ibin++)
+        stats.histogram[ibin] = 0;
+    stats.count = 0;
+    stats.latency_count = 0;
+}
+
+static float ticks_to_us(const double value) {
+    return value * 1e6 / ticks_per_second();
+}
+
+static void report_printf(const char * format, ...) {
+    /* appends to the report, truncating it if it would overflow */
+    va_list args;
+    va_start(args, format);
+    const int length = vsnprintf(report + report_length, REPORT_SIZE - report_length, format, args);
+    va_end(args);
+    if (length > 0) report_length += (size_t)length < REPORT_SIZE - report_length ? (size_t)length : REPORT_SIZE - 1 - report_length;
+}
+
+static void report_drain(void) {
+    if (report_written >= report_length) return;
+
+    const size_t left = report_length - report_written;
+    const size_t count = left < report_bytes_per_chunk ? left : report_bytes_per_chunk;
+    fwrite(report + report_written, 1, count, stderr);
+    report_written += count;
+    if (report_written >= report_length) {
+        fflush(stderr);
+        report_length = report_written = 0;
+    }
+}
+
+static void interval_stats_print(const char * name, const struct interval_stats * s, const size_t count) {
+    if (!count) return;
+    const double mean = (double)s->sum / count;
+    report_printf("%s: min %.1f us, mean %.1f us, max %.1f us (%.1f%%, %.1f%%, %.1f%% of deadline)\n",
+            name, ticks_to_us(s->min), ticks_to_us(mean), ticks_to_us(s->max),
+            100.0f * s->min / deadline, 100.0 * mean / deadline, 100.0f * s->max / deadline);
+}
+
+static void stats_print(const size_t ichunk) {
+    report_printf("chunks %u-%u, deadline %.1f us:\n", (unsigned)(ichunk + 1 - stats.count),
+            (unsigned)ichunk, ticks_to_us(deadline));
+    interval_stats_print("fill", &stats.fill, stats.count);
+    interval_stats_print("idle", &stats.idle, stats.count);
+    interval_stats_print("latency", &stats.latency, stats.latency_count);
+
+    report_printf("fill histogram, in tenths of deadline:");
+    for (size_t ibin = 0; ibin < HISTOGRAM_BINS; ibin++)
+        report_printf(" %u", (unsigned)stats.histogram[ibin]);
+    report_printf("\n");
+
+    /* the fill time is almost all per channel or voice, so scaling by its worst case gives a
+     ceiling on how many of them this configuration could sustain */
+    if (stats.fill.max)
+        report_printf("%s: %u, ceiling about %u at the worst fill time\n", scale_name, (unsigned)scale_count,
+                (unsigned)((uint64_t)scale_count * deadline / stats.fill.max));
+
+    if (underrun_stats.count)
+        report_printf("underruns: %u, most recent at chunk %u, %.3f s ago\n",
+                (unsigned)underrun_stats.count, (unsigned)underrun_stats.last_chunk,
+                (double)(ichunk - underrun_stats.last_chunk) * samples_per_chunk * TOP / SYS_CLOCK_HZ);
+}
+
+void profile_init(void) {
+    /* one chunk's worth of samples at the pwm wrap rate, in ticks */
+    deadline = (uint64_t)samples_per_chunk * TOP * ticks_per_second() / SYS_CLOCK_HZ;
+    report_bytes_per_chunk = (uint64_t)PROFILE_REPORT_BYTES_PER_SECOND * samples_per_chunk * TOP / SYS_CLOCK_HZ;
+    if (!report_bytes_per_chunk) report_bytes_per_chunk = 1;
+    stats_reset();
+}
+
+void profile_scale(const char * name, const size_t count) {
+    scale_name = name;
+    scale_count = count;
+}
+
+void profile_fill_start(const size_t ichunk) {
+    profile_ring[ichunk % PROFILE_RING_LENGTH].fill_start = ticks();
+}
+
+void profile_fill_end(const size_t ichunk) {
+    profile_ring[ichunk % PROFILE_RING_LENGTH].fill_end = ticks();
+    last_filled = ichunk;
+}
+
+void profile_wake(const size_t ichunk) {
+    struct chunk_timing * const this = profile_ring + ichunk % PROFILE_RING_LENGTH;
+    this->wake = ticks();
+    if (ichunk != last_filled) {
+        report_drain();
+        return;
+    }
+
+    const uint32_t fill = this->fill_end - this->fill_start;
+    interval_stats_accumulate(&stats.fill, fill);
+    interval_stats_accumulate(&stats.idle, this->wake - this->fill_end);
+
+    const size_t ibin = (uint64_t)fill * (HISTOGRAM_BINS - 1) / deadline;
+    stats.histogram[ibin < HISTOGRAM_BINS ? ibin : HISTOGRAM_BINS - 1]++;
+    stats.count++;
+
+    /* the consumer has just finished the chunk before the one it is now playing, and the time
+     from starting to fill that chunk until now is the latency from synthesis to output */
+    if (ichunk + 2 >= chunk_count && chunk_count - 2 < PROFILE_RING_LENGTH) {
+        const size_t iplaying = ichunk + 2 - chunk_count;
+        interval_stats_accumulate(&stats.latency, this->wake - profile_ring[iplaying % PROFILE_RING_LENGTH].fill_start);
+        stats.latency_count++;
+    }
+
+    /* a report still being written out when the next is due is not interrupted, and the next
+     carries on accumulating until it is done */
+    if (stats.count >= PROFILE_REPORT_CHUNKS && !report_length) {
+        stats_print(ichunk);
+        stats_reset();
+    }
+    report_drain();
+}
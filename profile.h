@@ -0,0 +1,52 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+/* per-chunk timing of the fill loop. ticks are cpu cycles from the dwt cycle counter on the target,
+ and nanoseconds from clock_gettime on the host, and are only ever differenced, so wrapping of the
+ 32-bit counter is harmless as long as no interval exceeds it. reports are given in microseconds
+ and as a fraction of the chunk deadline, so that numbers are comparable across targets */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* implemented by the platform, alongside the rest of the output side */
+uint32_t ticks(void);
+uint32_t ticks_per_second(void);
+
+/* how many of the most recent chunks to keep raw timestamps for */
+#define PROFILE_RING_LENGTH 64
+
+/* how often to dump the accumulated statistics, in chunks, about every 5.6 s */
+#define PROFILE_REPORT_CHUNKS 256
+
+/* the rate at which the report is written out, in bytes per second of audio, spread evenly over
+ the chunks. stdio on the target blocks until each byte is on the uart, and the whole report
+ would take longer than a chunk, so it is written a few bytes per chunk instead, by default in a
+ tenth of the time of each chunk at 115200 baud */
+#ifndef PROFILE_REPORT_BYTES_PER_SECOND
+#define PROFILE_REPORT_BYTES_PER_SECOND 1152
+#endif
+
+struct chunk_timing {
+    uint32_t fill_start, fill_end, wake;
+};
+
+/* the most recent chunks, indexed by chunk index modulo PROFILE_RING_LENGTH */
+extern struct chunk_timing profile_ring[PROFILE_RING_LENGTH];
+
+void profile_init(void);
+
+/* what the fill time is mostly proportional to, and how many of it there are, from which the report
+ gives a ceiling on how many could be sustained, by default the number of output channels */
+void profile_scale(const char * name, const size_t count);
+
+/* call immediately before and after filling chunk ichunk, and after waking from the wait that
+ follows it. the wake also accumulates statistics, formats a report of them when they are due,
+ and writes out the next few bytes of the report via stdio.
+ besides fill and idle time, the report includes the achieved latency from the start of filling
+ a chunk to the start of its playback, which bounds how long a parameter change takes to be heard */
+void profile_fill_start(const size_t ichunk);
+void profile_fill_end(const size_t ichunk);
+void profile_wake(const size_t ichunk);
+
+#endif
@@ -0,0 +1,127 @@
+#include "quantize.h"
+
+#include <math.h>
+
+/* regularization of the coefficient design, relative to the width of the band */
+#define REGULARIZATION 0.00001
+
+/* bound on the error fed back, in levels, so that clipping at the rails cannot run away */
+#define ERROR_LIMIT 4.0f
+
+uint64_t xorshift64star(void) {
+    /* marsaglia et al., yields 64 bits, most significant are most random */
+    static uint64_t x = 1; /* must be nonzero */
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+static float frand_minus_frand(void) {
+    /* generate 64 random bits, of which we will use the most significant 46, in two groups of 23 */
+    const uint64_t bits = xorshift64star();
+
+    /* generate two random numbers each uniformly distributed on [1.0f, 2.0f) */
+    const union { uint32_t u; float f; } x = { .u = 0x3F800000U | ((bits >> 41) & 0x7FFFFFU) };
+    const union { uint32_t u; float f; } y = { .u = 0x3F800000U | ((bits >> 18) & 0x7FFFFFU) };
+
+    /* and subtract them, yielding a triangular distribution on (-1.0f, +1.0f) */
+    return x.f - y.f;
+}
+
+static double band_integral(const unsigned lag, const double band) {
+    /* integral of cos(lag w) over w in [0, band pi) */
+    return lag ? sin(lag * band * M_PI) / lag : band * M_PI;
+}
+
+void quantizer_init(struct quantizer * q, const unsigned top, const unsigned order, const float band) {
+    *q = (struct quantizer) { .top = top, .order = order < QUANTIZER_ORDER_MAX ? order : QUANTIZER_ORDER_MAX };
+
+    /* least squares: minimize the integral of |ntf|^2 over the band, plus a small multiple of its
+     integral over all frequencies, which yields a symmetric toeplitz system in the coefficients */
+    double a[QUANTIZER_ORDER_MAX][QUANTIZER_ORDER_MAX + 1];
+    for (size_t j = 0; j < q->order; j++) {
+        for (size_t k = 0; k < q->order; k++)
+            a[j][k] = band_integral(j > k ? j - k : k - j, band) + (j == k ? REGULARIZATION * band * M_PI : 0.0);
+        a[j][q->order] = band_integral(j + 1, band);
+    }
+
+    /* gaussian elimination, which is fine without pivoting as the system is positive definite */
+    for (size_t j = 0; j < q->order; j++)
+        for (size_t i = j + 1; i < q->order; i++) {
+            const double ratio = a[i][j] / a[j][j];
+            for (size_t k = j; k <= q->order; k++)
+                a[i][k] -= ratio * a[j][k];
+        }
+
+    for (size_t j = q->order; j--; ) {
+        double sum = a[j][q->order];
+        for (size_t k = j + 1; k < q->order; k++)
+            sum -= a[j][k] * q->coefficients[k];
+        q->coefficients[j] = sum / a[j][j];
+    }
+}
+
+void quantize(struct quantizer * q, uint16_t * dst, const size_t stride, const float * src, const size_t count) {
+    const float top = q->top;
+
+    for (size_t ival = 0; ival < count; ival++) {
+        float feedback = 0.0f;
+        for (size_t k = 0; k < q->order; k++)
+            feedback += q->coefficients[k] * q->error[k];
+
+        /* map [-1.0, 1.0] to [0, top], less the filtered error of previous samples */
+        const float wanted = (0.5f + 0.5f * src[ival]) * top - feedback;
+
+        /* round with triangular pdf dither, within the range of the pwm */
+        float dithered = wanted + 0.5f + frand_minus_frand();
+        if (dithered < 0.0f) dithered = 0.0f;
+        if (dithered > top) dithered = top;
+        const uint16_t level = dithered;
+        dst[ival * stride] = level;
+
+        if (q->order) {
+            float error = level - wanted;
+            if (error > ERROR_LIMIT) error = ERROR_LIMIT;
+            if (error < -ERROR_LIMIT) error = -ERROR_LIMIT;
+
+            for (size_t k = q->order - 1; k; k--)
+                q->error[k] = q->error[k - 1];
+            q->error[0] = error;
+        }
+    }
+}
+
+void dual_quantizer_init(struct dual_quantizer * q, const unsigned top, const float ratio) {
+    *q = (struct dual_quantizer) { .top = top, .ratio = ratio < 1.0f ? 1.0f : ratio > top ? top : ratio };
+}
+
+void dual_quantize(struct dual_quantizer * q, uint16_t * dst, const size_t stride, const float * src, const size_t count) {
+    const float top = q->top, ratio = q->ratio;
+
+    for (size_t ival = 0; ival < count; ival++) {
+        /* map [-1.0, 1.0] to [0, top x ratio] fine steps, and round with triangular pdf dither */
+        float dithered = (0.5f + 0.5f * src[ival]) * top * ratio + 0.5f + frand_minus_frand();
+        if (dithered < 0.0f) dithered = 0.0f;
+        if (dithered > top * ratio) dithered = top * ratio;
+
+        /* whole coarse levels, and the remainder in fine steps, which is less than the ratio */
+        uint16_t coarse = dithered / ratio;
+        if (coarse > top) coarse = top;
+        const float fine = dithered - coarse * ratio;
+
+        dst[ival * stride] = coarse;
+        dst[ival * stride + 1] = fine > 0.0f ? (uint16_t)fine : 0;
+    }
+}
+
+void dual_calibrate(struct dual_quantizer * q, uint16_t * dst, const size_t stride, const size_t count) {
+    /* coarse levels the whole range of the fine channel is worth, about the midpoint */
+    const unsigned k = q->top / q->ratio, middle = q->top / 2 - k / 2;
+
+    for (size_t ival = 0; ival < count; ival++) {
+        const int high = q->calibration_phase++ % DUAL_CALIBRATION_PERIOD < DUAL_CALIBRATION_PERIOD / 2;
+        dst[ival * stride] = middle + (high ? k : 0);
+        dst[ival * stride + 1] = high ? 0 : (uint16_t)(k * q->ratio + 0.5f);
+    }
+}
@@ -0,0 +1,76 @@
+#ifndef QUANTIZE_H
+#define QUANTIZE_H
+
+/* maps samples in [-1, 1] to pwm levels in [0, top], with triangular pdf dither, and optionally
+ error feedback noise shaping: the quantization error of each sample, filtered, is subtracted
+ from the following samples, which shapes the spectrum of the total error by the noise transfer
+ function 1 - sum(c[k] z^-(k+1)). the coefficients minimize the error within [0, band) of nyquist,
+ regularized by its total power so that the out-of-band gain, and hence the amplitude of the
+ error and the risk of overloading the quantizer, stays modest. order 0 is plain tpdf dither.
+
+ a higher order buys more in-band snr for a narrower band. without oversampling, there is little
+ room above the band to push noise into, so a band much above half of nyquist gains little, and
+ signals within a few percent of full scale will see the shaped noise clipped at the rails */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define QUANTIZER_ORDER_MAX 8
+
+#ifndef QUANTIZER_ORDER
+#define QUANTIZER_ORDER 0
+#endif
+
+#ifndef QUANTIZER_BAND_HZ
+#define QUANTIZER_BAND_HZ 10000.0f
+#endif
+
+struct quantizer {
+    float top;
+    unsigned order;
+    float coefficients[QUANTIZER_ORDER_MAX];
+
+    /* most recent error first */
+    float error[QUANTIZER_ORDER_MAX];
+};
+
+/* the generator behind the dither, exposed for anything else which needs cheap random bits */
+uint64_t xorshift64star(void);
+
+/* band is the upper edge of the band of interest as a fraction of nyquist */
+void quantizer_init(struct quantizer * q, const unsigned top, const unsigned order, const float band);
+
+/* dst is written every stride elements, so that channels can be interleaved */
+void quantize(struct quantizer * q, uint16_t * dst, const size_t stride, const float * src, const size_t count);
+
+/* dual pwm: a coarse level on channel a and a fine level on channel b of the same slice, summed by
+ resistors weighting the fine channel by 1 / ratio of the coarse, so each coarse level is split
+ into ratio fine steps, e.g. TOP 1024 and ratio 64 for 16 bits, with the coarse level the top 10
+ bits of the sample and the fine level the bottom 6. the ratio must be at most TOP, so that the
+ fine channel spans at least one coarse level. using the measured ratio of the actual resistors,
+ rather than the nominal one, makes up for their mismatch, as the split is then done in terms of
+ the weights they actually have */
+#ifndef DUAL_RATIO
+#define DUAL_RATIO 64.0f
+#endif
+
+/* frames per period of the calibration pattern */
+#define DUAL_CALIBRATION_PERIOD 128
+
+struct dual_quantizer {
+    float top, ratio;
+    size_t calibration_phase;
+};
+
+void dual_quantizer_init(struct dual_quantizer * q, const unsigned top, const float ratio);
+
+/* writes the coarse and fine levels of each frame to dst[0] and dst[1], frames stride elements apart */
+void dual_quantize(struct dual_quantizer * q, uint16_t * dst, const size_t stride, const float * src, const size_t count);
+
+/* for calibration, alternates every half period between k coarse levels and the k x ratio fine
+ levels which should be equivalent, for the largest k the fine channel can reach. if the ratio is
+ right, the output is constant, and otherwise it is a square wave whose amplitude is proportional
+ to the error, so the ratio can be trimmed until it nulls, by ear or on a scope */
+void dual_calibrate(struct dual_quantizer * q, uint16_t * dst, const size_t stride, const size_t count);
+
+#endif
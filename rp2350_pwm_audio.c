@@ -1,95 +1,167 @@
 #include <math.h>
-#include <complex.h>
 
-#include "hardware/clocks.h"
-#include "hardware/irq.h"
-#include "hardware/sync.h"
-#include "hardware/pwm.h"
-#include "hardware/dma.h"
-#include "hardware/gpio.h"
+#include "audio_out.h"
+#include "profile.h"
+#include "underrun.h"
+#include "quantize.h"
+#include "interpolate.h"
+#include "oscillators.h"
+#include "fixed.h"
+#include "dds.h"
+#include "wavetable.h"
+#include "polyblep.h"
+#include "voices.h"
+#include "events.h"
+#include "fm.h"
+#include "pluck.h"
 
-#define PWM_PIN 3
+_Static_assert(OVERSAMPLING <= INTERPOLATOR_FACTOR_MAX, "too much oversampling");
 
-void yield(void) {
-    /* we could do context switching here for cooperative multitasking if we wanted */
-    __dsb();
-    __wfe();
-}
+/* if nonzero, each slice carries one high resolution output, split into coarse and fine levels on
+ its two channels, see dual_quantize(), instead of two independent outputs */
+#ifndef DUAL_PWM
+#define DUAL_PWM 0
+#endif
+_Static_assert(!DUAL_PWM || 2 == SLICE_CHANNELS, "dual pwm needs both channels of each slice");
 
-#define BUFFER_WRAP_BITS 12
-#define BYTES_PER_CHUNK 2048
+/* if nonzero, in dual pwm, emit the calibration pattern of dual_calibrate() instead of the tone */
+#ifndef DUAL_CALIBRATE
+#define DUAL_CALIBRATE 0
+#endif
 
-#define SAMPLES_PER_CHUNK (BYTES_PER_CHUNK / sizeof(uint16_t))
+/* independent output signals, one per channel, or one per slice in dual pwm */
+#define OUTPUTS (DUAL_PWM ? AUDIO_OUT_SLICES : AUDIO_OUT_CHANNELS)
 
-__attribute((aligned(sizeof(uint16_t) * 2 * SAMPLES_PER_CHUNK)))
-static uint16_t buffer[2][SAMPLES_PER_CHUNK];
-_Static_assert(1U << BUFFER_WRAP_BITS == sizeof(buffer), "wtf");
+/* voices per output, which play a chord on successive harmonics from the fourth of the tone */
+#ifndef VOICES
+#define VOICES 1
+#endif
+_Static_assert(VOICES >= 1 && VOICES <= OSCILLATOR_BANK_MAX, "too many voices");
 
-static float cmagsquaredf(const float complex x) {
-    return crealf(x) * crealf(x) + cimagf(x) * cimagf(x);
-}
+/* if nonzero, emit the real and imaginary parts of the same carrier on the left and right
+ outputs, as a quadrature pair whose samples always land in the same dma transfer */
+#ifndef QUADRATURE
+#define QUADRATURE 0
+#endif
+_Static_assert(!QUADRATURE || 2 == OUTPUTS, "quadrature output needs two outputs");
 
-static uint64_t xorshift64star(void) {
-    /* marsaglia et al., yields 64 bits, most significant are most random */
-    static uint64_t x = 1; /* must be nonzero */
-    x ^= x >> 12;
-    x ^= x << 25;
-    x ^= x >> 27;
-    return x * 0x2545F4914F6CDD1DULL;
-}
+/* if nonzero, synthesize and quantize in integers only, see fixed.h, which is bit-exact between
+ the host and the target, and needs no fpu */
+#ifndef FIXED_POINT
+#define FIXED_POINT 0
+#endif
+_Static_assert(!FIXED_POINT || (1 == OVERSAMPLING && !DUAL_PWM && !QUANTIZER_ORDER && VOICES <= FIXED_BANK_MAX),
+               "the fixed point path has no interpolation, dual pwm or noise shaping");
+
+/* if nonzero, synthesize with phase accumulators and a table, see dds.h, whose frequencies are exact */
+#ifndef DDS
+#define DDS 0
+#endif
+_Static_assert(!DDS || (!FIXED_POINT && VOICES <= DDS_BANK_MAX), "dds is float only");
+
+/* if nonzero, in dds, generate the table addresses with the sio interpolators */
+#ifndef DDS_INTERP
+#define DDS_INTERP 0
+#endif
+_Static_assert(!DDS_INTERP || (DDS && !QUADRATURE), "the interpolator kernel is for dds, without quadrature");
+
+/* if nonzero, synthesize WAVEFORM from band-limited wavetables, see wavetable.h */
+#ifndef WAVETABLE
+#define WAVETABLE 0
+#endif
+#ifndef WAVEFORM
+#define WAVEFORM WAVEFORM_SAW
+#endif
+_Static_assert(!WAVETABLE || (!FIXED_POINT && !DDS && !QUADRATURE && VOICES <= WAVETABLE_BANK_MAX),
+               "wavetables are float only, and have no quadrature");
+
+/* if nonzero, synthesize WAVEFORM by polyblep, see polyblep.h, with the square PULSE_WIDTH high */
+#ifndef POLYBLEP
+#define POLYBLEP 0
+#endif
+#ifndef PULSE_WIDTH
+#define PULSE_WIDTH 0.5f
+#endif
+_Static_assert(!POLYBLEP || (!FIXED_POINT && !DDS && !WAVETABLE && !QUADRATURE && VOICES <= POLYBLEP_BANK_MAX &&
+                             WAVEFORM_SINE != WAVEFORM), "polyblep is float only, for a saw, square or triangle");
+
+/* if nonzero, the voices of the bank of phasors start silent, and are a pool for notes played by
+ time-stamped events, see events.h and voices.h, as a pattern of beeps every BEEP_PERIOD seconds,
+ which is not a whole number of chunks, so that each beep lands mid-chunk, on its own sample. each
+ lasts BEEP_LENGTH seconds, so several overlap, and with fewer voices, VOICE_STEAL picks which to cut */
+#ifndef EVENTS
+#define EVENTS 0
+#endif
+_Static_assert(!EVENTS || (!FIXED_POINT && !DDS && !WAVETABLE && !POLYBLEP), "events play the bank of phasors");
+
+#define BEEP_PERIOD 0.3
+#define BEEP_LENGTH 1.0
+
+/* the queue holds the note-offs of the beeps still sounding, and the beeps posted up to two chunks
+ ahead, on each output */
+#define BEEPS_QUEUED ((int)((BEEP_LENGTH + 2.0 * SAMPLES_PER_CHUNK * TOP / SYS_CLOCK_HZ) / BEEP_PERIOD) + 2)
+_Static_assert(!EVENTS || 2 * OUTPUTS * BEEPS_QUEUED <= EVENT_QUEUE_MAX, "event queue too small for the beeps");
+
+/* attack and release of each beep, long enough not to click */
+#define BEEP_ATTACK 0.002
+#define BEEP_RELEASE 0.05
+
+/* if nonzero, the beeps are shaped instead by an envelope, see envelope.h, with the decay and
+ release of ENVELOPE_SHAPE, and the durations in seconds below */
+#ifndef ENVELOPE
+#define ENVELOPE 0
+#endif
+#ifndef ENVELOPE_SHAPE
+#define ENVELOPE_SHAPE ENVELOPE_EXPONENTIAL
+#endif
+_Static_assert(!ENVELOPE || EVENTS, "envelopes shape the notes played by events");
 
-static float frand_minus_frand(void) {
-    /* generate 64 random bits, of which we will use the most significant 46, in two groups of 23 */
-    const uint64_t bits = xorshift64star();
+#define ENVELOPE_ATTACK 0.005
+#define ENVELOPE_DECAY 0.1
+#define ENVELOPE_SUSTAIN 0.5f
+#define ENVELOPE_RELEASE 0.2
 
-    /* generate two random numbers each uniformly distributed on [1.0f, 2.0f) */
-    const union { uint32_t u; float f; } x = { .u = 0x3F800000U | ((bits >> 41) & 0x7FFFFFU) };
-    const union { uint32_t u; float f; } y = { .u = 0x3F800000U | ((bits >> 18) & 0x7FFFFFU) };
+/* if nonzero, each output is instead a bank of fm voices, see fm.h, with FM_OPERATORS_USED
+ operators routed by FM_ALGORITHM, which play a bell-like beep every BEEP_PERIOD seconds on each
+ voice in turn, each starting on its own sample and dying away by itself */
+#ifndef FM
+#define FM 0
+#endif
+#ifndef FM_OPERATORS_USED
+#define FM_OPERATORS_USED 4
+#endif
+#ifndef FM_ALGORITHM
+#define FM_ALGORITHM FM_STACK
+#endif
+_Static_assert(!FM || (!FIXED_POINT && !DDS && !WAVETABLE && !POLYBLEP && !EVENTS && !QUADRATURE && VOICES <= FM_BANK_MAX &&
+                       FM_OPERATORS_USED >= 2 && FM_OPERATORS_USED <= FM_OPERATORS), "fm is float only, of 2 to 4 operators");
 
-    /* and subtract them, yielding a triangular distribution on (-1.0f, +1.0f) */
-    return x.f - y.f;
+/* if nonzero, each output is instead a bank of plucked strings, see pluck.h, which play the same
+ pattern as fm, each ringing for PLUCK_DECAY seconds to -60 dB */
+#ifndef PLUCK
+#define PLUCK 0
+#endif
+_Static_assert(!PLUCK || (!FIXED_POINT && !DDS && !WAVETABLE && !POLYBLEP && !EVENTS && !FM && !QUADRATURE && VOICES <= PLUCK_BANK_MAX),
+               "plucked strings are float only");
+_Static_assert(!PLUCK || OUTPUTS * sizeof(struct pluck_bank) <= 1U << 18, "plucked strings must fit in half the sram");
+
+#define PLUCK_DECAY 1.5
+#define PLUCK_BRIGHTNESS 0.7f
+
+static int ring_full(const size_t ichunk) {
+    /* whether the consumer is still playing the previous contents of the chunk after this one */
+    const size_t iplaying = audio_out_position() / samples_per_chunk;
+    return (ichunk % chunk_count + chunk_count - iplaying) % chunk_count == chunk_count - 1;
 }
 
 int main() {
-    /* enable sevonpend, so that we don't need nearly-empty ISRs */
-    scb_hw->scr |= M33_SCR_SEVONPEND_BITS;
-
-    set_sys_clock_48mhz();
-
-    gpio_set_function(PWM_PIN, GPIO_FUNC_PWM);
-    const unsigned slice_num = pwm_gpio_to_slice_num(PWM_PIN);
-
-    /* set up pwm to tick at 48 MHz (assuming sys is 48 MHz) and wrap 46875 times per second */
-    pwm_config config = pwm_get_default_config();
-    pwm_config_set_clkdiv_int(&config, 1);
-#define TOP 1024U
-    pwm_config_set_wrap(&config, TOP);
-
-#define IDMA_PWM 0
-    dma_channel_claim(IDMA_PWM);
-    dma_channel_config cfg = dma_channel_get_default_config(IDMA_PWM);
-    channel_config_set_dreq(&cfg, pwm_get_dreq(slice_num));
-    channel_config_set_read_increment(&cfg, true);
-    channel_config_set_write_increment(&cfg, false);
-    channel_config_set_ring(&cfg, false, BUFFER_WRAP_BITS);
-    channel_config_set_transfer_data_size(&cfg, DMA_SIZE_16);
-
-    dma_channel_configure(IDMA_PWM,
-                          &cfg,
-                          (uint16_t *)((void *)&pwm_hw->slice[slice_num].cc) + (PWM_PIN % 2),
-                          &buffer[0],
-                          SAMPLES_PER_CHUNK | (1U << 28),
-                          false);
-
-    /* enable interrupt for dma, but leave it disabled in nvic */
-    dma_channel_acknowledge_irq0(IDMA_PWM);
-    dma_channel_set_irq0_enabled(IDMA_PWM, true);
-    __dsb();
-    irq_set_enabled(DMA_IRQ_0, false);
-
-    dma_channel_start(IDMA_PWM);
-
-    const float sample_rate = 48e6f / TOP;
+    audio_out_init(AUDIO_OUT_MODE, CHUNK_COUNT, SAMPLES_PER_CHUNK);
+    profile_init();
+    if (VOICES > 1) profile_scale("voices", OUTPUTS * VOICES);
+
+    /* rate at which samples are synthesized, which is the pwm rate unless oversampling */
+    const float pwm_rate = (float)SYS_CLOCK_HZ / TOP;
+    const float sample_rate = pwm_rate / OVERSAMPLING;
 
     /* this can be any value between dc and fs/2, does not need to be an integer */
     const float tone_frequency = 900.0f;
@@ -97,38 +169,225 @@ int main() {
     /* multiplier relative to full scale */
     const float tone_amplitude = 1.0f;
 
-    const float complex advance = cexpf(I * 2.0f * (float)M_PI * tone_frequency / sample_rate);
+    /* beyond one output, each plays half of the base frequency above the one before it, e.g. in
+     stereo the right channel plays a fifth above the left, unless in quadrature. the banks of
+     each kind of synthesis other than the one built, and the output stages not in use, are a
+     single one, never initialized */
+    static struct oscillator_bank bank[OUTPUTS];
+    static struct fixed_bank fixed_bank[FIXED_POINT ? OUTPUTS : 1];
+    static struct dds_bank dds_bank[DDS ? OUTPUTS : 1];
+    static struct wavetable_bank wavetable_bank[WAVETABLE ? OUTPUTS : 1];
+    static struct polyblep_bank polyblep_bank[POLYBLEP ? OUTPUTS : 1];
+    static struct fm_bank fm_bank[FM ? OUTPUTS : 1];
+    static struct pluck_bank pluck_bank[PLUCK ? OUTPUTS : 1];
+    static struct quantizer quantizer[FIXED_POINT || DUAL_PWM ? 1 : OUTPUTS];
+    static struct interpolator interpolator[OVERSAMPLING > 1 ? OUTPUTS : 1];
+    static struct dual_quantizer dual_quantizer[DUAL_PWM ? OUTPUTS : 1];
+
+    /* built at boot, and shared by all voices, and only referenced if in use, so that otherwise it
+     is not linked in */
+    static struct wavetable wavetable;
+    if (WAVETABLE) wavetable_init(&wavetable, waveform_harmonic(WAVEFORM));
+
+    /* a carrier at the note, modulated by an inharmonic ratio whose index dies away faster than
+     the note, which is what makes it a bell, and by two more operators, if in use, for the attack */
+    static struct fm_patch fm_patch = {
+        .operators = FM_OPERATORS_USED,
+        .ratio = { 1.0f, 3.5f, 1.0f, 7.0f },
+        .level = { 1.0f, 3.0f, 1.0f, 1.5f },
+        .feedback = { 0.0f, 0.0f, 0.0f, 0.5f },
+    };
+    fm_patch.algorithm = fm_algorithms[FM_ALGORITHM];
+    envelope_init(fm_patch.envelope + 0, 0.002 * sample_rate, BEEP_LENGTH * sample_rate, 0.0f, 0, ENVELOPE_EXPONENTIAL);
+    envelope_init(fm_patch.envelope + 1, 0, 0.4 * BEEP_LENGTH * sample_rate, 0.0f, 0, ENVELOPE_EXPONENTIAL);
+    envelope_init(fm_patch.envelope + 2, 0.002 * sample_rate, 0.8 * BEEP_LENGTH * sample_rate, 0.0f, 0, ENVELOPE_EXPONENTIAL);
+    envelope_init(fm_patch.envelope + 3, 0, 0.1 * BEEP_LENGTH * sample_rate, 0.0f, 0, ENVELOPE_EXPONENTIAL);
+
+    for (size_t ichannel = 0; ichannel < OUTPUTS; ichannel++) {
+        oscillator_bank_init(bank + ichannel, OSCILLATOR_RENORMALIZE_INTERVAL, OSCILLATOR_LANES);
+        for (size_t ivoice = 0; ivoice < VOICES; ivoice++)
+            oscillator_bank_add(bank + ichannel, tone_frequency * (1.0f + 0.5f * ichannel) * (4 + ivoice % 16) / 4.0f / sample_rate,
+                                EVENTS ? 0.0f : tone_amplitude / VOICES);
 
-    /* this will evolve along the unit circle */
-    float complex carrier = -1.0f;
+        /* in double, so that the phase increment is exactly the nearest to the frequency */
+        if (DDS) {
+            dds_bank_init(dds_bank + ichannel);
+            for (size_t ivoice = 0; ivoice < VOICES; ivoice++)
+                dds_bank_add(dds_bank + ichannel, (double)tone_frequency * (1.0 + 0.5 * ichannel) * (4 + ivoice % 16) / 4.0 /
+                             ((double)SYS_CLOCK_HZ / TOP / OVERSAMPLING), tone_amplitude / VOICES);
+        }
+
+        if (WAVETABLE) {
+            wavetable_bank_init(wavetable_bank + ichannel, &wavetable);
+            for (size_t ivoice = 0; ivoice < VOICES; ivoice++)
+                wavetable_bank_add(wavetable_bank + ichannel, (double)tone_frequency * (1.0 + 0.5 * ichannel) * (4 + ivoice % 16) / 4.0 /
+                                   ((double)SYS_CLOCK_HZ / TOP / OVERSAMPLING), tone_amplitude / VOICES);
+        }
+
+        if (POLYBLEP) {
+            polyblep_bank_init(polyblep_bank + ichannel, WAVEFORM);
+            for (size_t ivoice = 0; ivoice < VOICES; ivoice++)
+                polyblep_set_width(polyblep_bank + ichannel,
+                                   polyblep_bank_add(polyblep_bank + ichannel, (double)tone_frequency * (1.0 + 0.5 * ichannel) * (4 + ivoice % 16) / 4.0 /
+                                                     ((double)SYS_CLOCK_HZ / TOP / OVERSAMPLING), tone_amplitude / VOICES), PULSE_WIDTH);
+        }
+
+        if (FM) {
+            fm_bank_init(fm_bank + ichannel, &fm_patch);
+            for (size_t ivoice = 0; ivoice < VOICES; ivoice++)
+                fm_bank_add(fm_bank + ichannel);
+        }
+
+        /* each string long enough for the lowest note of the pattern */
+        if (PLUCK) {
+            pluck_bank_init(pluck_bank + ichannel);
+            for (size_t ivoice = 0; ivoice < VOICES; ivoice++)
+                pluck_bank_add(pluck_bank + ichannel, (double)tone_frequency * (1.0 + 0.5 * ichannel) / 4.0 / sample_rate);
+        }
+
+        if (FIXED_POINT) {
+            fixed_bank_init(fixed_bank + ichannel);
+            for (size_t ivoice = 0; ivoice < VOICES; ivoice++)
+                fixed_bank_add(fixed_bank + ichannel, tone_frequency * (1.0f + 0.5f * ichannel) * (4 + ivoice % 16) / 4.0f / sample_rate,
+                               tone_amplitude / VOICES);
+        }
+
+        if (!FIXED_POINT && !DUAL_PWM) quantizer_init(quantizer + ichannel, TOP, QUANTIZER_ORDER, QUANTIZER_BAND_HZ / (pwm_rate / 2.0f));
+        if (OVERSAMPLING > 1) interpolator_init(interpolator + ichannel, OVERSAMPLING);
+        if (DUAL_PWM) dual_quantizer_init(dual_quantizer + ichannel, TOP, DUAL_RATIO);
+    }
+
+    /* synthesized samples in [-1.0, 1.0], and the same interpolated up to the pwm rate if oversampling */
+    static float samples[OUTPUTS][FIXED_POINT ? 1 : RING_SAMPLES / 2 / OVERSAMPLING];
+    static float upsampled[OUTPUTS][OVERSAMPLING > 1 ? RING_SAMPLES / 2 : 1];
+
+    /* or in q31, if in fixed point */
+    static int32_t fixed_samples[OUTPUTS][FIXED_POINT ? RING_SAMPLES / 2 : 1];
+
+    /* the next beep, in samples since the first chunk */
+    static struct event_queue events;
+    event_queue_init(&events);
+    static struct voice_pool pool[OUTPUTS];
+    for (size_t ichannel = 0; ichannel < OUTPUTS; ichannel++)
+        voice_pool_init(pool + ichannel, bank + ichannel, VOICE_STEAL);
+
+    static struct envelope envelope;
+    envelope_init(&envelope, ENVELOPE_ATTACK * sample_rate, ENVELOPE_DECAY * sample_rate, ENVELOPE_SUSTAIN,
+                  ENVELOPE_RELEASE * sample_rate, ENVELOPE_SHAPE);
+    for (size_t ichannel = 0; ichannel < OUTPUTS; ichannel++)
+        if (ENVELOPE) oscillator_bank_envelope(bank + ichannel, &envelope);
+    uint64_t beep_time = 0;
+    size_t ibeep = 0;
 
     for (size_t ichunk = 0;; ichunk++) {
-        uint16_t * const dst = buffer[ichunk % 2];
-        for (size_t ival = 0; ival < SAMPLES_PER_CHUNK; ival++) {
-            const float sample = crealf(carrier) * tone_amplitude;
+        profile_fill_start(ichunk);
+        underrun_fill_start(ichunk);
+
+        const size_t samples_to_synthesize = samples_per_chunk / OVERSAMPLING;
+        const uint64_t chunk_time = (uint64_t)ichunk * samples_to_synthesize;
 
-            /* rotate complex sinusoid at the desired frequency */
-            carrier *= advance;
+        /* keep the queue a chunk or so ahead of the beeps */
+        while (EVENTS && beep_time < chunk_time + 2 * samples_to_synthesize && events.count + 2 * OUTPUTS <= EVENT_QUEUE_MAX) {
+            for (size_t ichannel = 0; ichannel < OUTPUTS; ichannel++) {
+                const struct event on = { .time = beep_time, .type = EVENT_NOTE_ON, .output = ichannel, .note = ibeep,
+                    .frequency = tone_frequency * (1.0f + 0.5f * ichannel) * (4 + ibeep % 16) / 4.0f / sample_rate,
+                    .amplitude = tone_amplitude / VOICES, .samples = BEEP_ATTACK * sample_rate };
+                const struct event off = { .time = beep_time + (uint64_t)(BEEP_LENGTH * sample_rate), .type = EVENT_NOTE_OFF,
+                    .output = ichannel, .note = ibeep, .samples = BEEP_RELEASE * sample_rate };
+                event_post(&events, &on);
+                event_post(&events, &off);
+            }
+            ibeep++;
+            beep_time = llround(ibeep * BEEP_PERIOD * sample_rate);
+        }
 
-            /* renormalize carrier to unity */
-            carrier = carrier * (3.0f - cmagsquaredf(carrier)) / 2.0f;
+        if (FIXED_POINT) {
+            if (QUADRATURE)
+                fixed_bank_render(fixed_bank, fixed_samples[0], fixed_samples[OUTPUTS - 1], samples_to_synthesize);
+            else
+                for (size_t ichannel = 0; ichannel < OUTPUTS; ichannel++)
+                    fixed_bank_render(fixed_bank + ichannel, fixed_samples[ichannel], NULL, samples_to_synthesize);
 
-            /* map [-1.0, 1.0] to [0, TOP] with triangular pdf dither */
-            dst[ival] = ((0.5f + 0.5f * sample) * TOP) + 0.5f + frand_minus_frand();
+            for (size_t ichannel = 0; ichannel < OUTPUTS; ichannel++)
+                quantize_fixed(TOP, audio_out_chunk(ichunk, ichannel), SLICE_CHANNELS, fixed_samples[ichannel], samples_per_chunk);
         }
+        else if (DDS && QUADRATURE)
+            dds_bank_render(dds_bank, samples[0], samples[OUTPUTS - 1], samples_to_synthesize);
+        else if (DDS && DDS_INTERP)
+            for (size_t ichannel = 0; ichannel < OUTPUTS; ichannel++)
+                dds_bank_render_interp(dds_bank + ichannel, samples[ichannel], samples_to_synthesize);
+        else if (DDS)
+            for (size_t ichannel = 0; ichannel < OUTPUTS; ichannel++)
+                dds_bank_render(dds_bank + ichannel, samples[ichannel], NULL, samples_to_synthesize);
+        else if (WAVETABLE)
+            for (size_t ichannel = 0; ichannel < OUTPUTS; ichannel++)
+                wavetable_bank_render(wavetable_bank + ichannel, samples[ichannel], samples_to_synthesize);
+        else if (POLYBLEP)
+            for (size_t ichannel = 0; ichannel < OUTPUTS; ichannel++)
+                polyblep_bank_render(polyblep_bank + ichannel, samples[ichannel], samples_to_synthesize);
+        else if (FM || PLUCK)
+            /* in sub-blocks which end wherever a beep is due, so that each lands on its own sample */
+            for (size_t ival = 0, count; ival < samples_to_synthesize; ival += count) {
+                for (; beep_time <= chunk_time + ival; beep_time = llround(++ibeep * BEEP_PERIOD * sample_rate))
+                    for (size_t ichannel = 0; ichannel < OUTPUTS; ichannel++) {
+                        const double frequency = (double)tone_frequency * (1.0 + 0.5 * ichannel) * (4 + ibeep % 4) / 16.0 / sample_rate;
+                        if (FM) fm_note_on(fm_bank + ichannel, ibeep % VOICES, frequency, tone_amplitude / VOICES);
+                        else pluck(pluck_bank + ichannel, ibeep % VOICES, frequency, tone_amplitude / VOICES, PLUCK_DECAY * sample_rate,
+                                   PLUCK_BRIGHTNESS);
+                    }
+
+                count = beep_time < chunk_time + samples_to_synthesize ? beep_time - chunk_time - ival : samples_to_synthesize - ival;
+                for (size_t ichannel = 0; ichannel < OUTPUTS; ichannel++)
+                    if (FM) fm_bank_render(fm_bank + ichannel, samples[ichannel] + ival, count);
+                    else pluck_bank_render(pluck_bank + ichannel, samples[ichannel] + ival, count);
+            }
+        else
+            /* in sub-blocks which end wherever an event is due, so that each lands on its own sample */
+            for (size_t ival = 0, count; ival < samples_to_synthesize; ival += count) {
+                count = EVENTS ? event_dispatch(&events, pool, chunk_time + ival, samples_to_synthesize - ival) : samples_to_synthesize - ival;
+
+                if (QUADRATURE)
+                    /* both parts of the same complex sinusoids, exactly 90 degrees apart */
+                    oscillator_bank_render(bank, samples[0] + ival, samples[OUTPUTS - 1] + ival, count);
+                else
+                    for (size_t ichannel = 0; ichannel < OUTPUTS; ichannel++)
+                        oscillator_bank_render(bank + ichannel, samples[ichannel] + ival, NULL, count);
+            }
+
+        /* identical interpolation and quantization in each channel preserves their relative phase */
+        for (size_t ichannel = 0; ichannel < OUTPUTS && !FIXED_POINT; ichannel++) {
+            float * const dst = samples[ichannel];
+
+            if (OVERSAMPLING > 1)
+                interpolate(interpolator + ichannel, upsampled[ichannel], dst, samples_to_synthesize);
+
+            /* map [-1.0, 1.0] to [0, TOP] with triangular pdf dither and optional noise shaping,
+             interleaving channels, or in dual pwm, to coarse and fine levels on both channels */
+            if (DUAL_PWM && DUAL_CALIBRATE)
+                dual_calibrate(dual_quantizer + ichannel, audio_out_chunk(ichunk, 2 * ichannel), SLICE_CHANNELS, samples_per_chunk);
+            else if (DUAL_PWM)
+                dual_quantize(dual_quantizer + ichannel, audio_out_chunk(ichunk, 2 * ichannel), SLICE_CHANNELS,
+                              OVERSAMPLING > 1 ? upsampled[ichannel] : dst, samples_per_chunk);
+            else
+                quantize(quantizer + ichannel, audio_out_chunk(ichunk, ichannel), SLICE_CHANNELS,
+                         OVERSAMPLING > 1 ? upsampled[ichannel] : dst, samples_per_chunk);
+        }
+
+        profile_fill_end(ichunk);
+
+        /* if the consumer overtook us while we were filling, skip ahead of it */
+        if (underrun_fill_end(ichunk))
+            ichunk = underrun_resync(ichunk);
 
-        /* if we just filled the first chunk and have not enabled the pwm yet, enable it,
-         and immediately fill the next chunk without waiting for an interrupt */
-        if (0 == ichunk && !(pwm_hw->slice[slice_num].csr & (1U << PWM_CH0_CSR_EN_LSB)))
-            pwm_init(slice_num, &config, true);
-        else {
-            /* run other tasks or low power sleep until next dma interrupt */
-            while (!(dma_hw->intr & 1U << IDMA_PWM))
-                yield();
-
-            /* acknowledge and clear the interrupt in both dma and nvic */
-            dma_hw->ints0 = 1U << IDMA_PWM;
-            irq_clear(DMA_IRQ_0);
+        /* once all but one chunk are filled, start the consumer, and immediately fill the last
+         chunk without waiting for it to finish with the first. after that, keep filling until
+         the ring is full, and then wait for the consumer to finish with a chunk */
+        if (ichunk + 2 == chunk_count)
+            audio_out_start();
+        else if (ichunk + 2 > chunk_count && ring_full(ichunk)) {
+            do audio_out_wait();
+            while (ring_full(ichunk));
+            profile_wake(ichunk);
         }
     }
 }
@@ -0,0 +1,81 @@
+#include "underrun.h"
+#include "audio_out.h"
+#include "profile.h"
+
+struct underrun_stats underrun_stats;
+
+static size_t headroom_at_start;
+static uint32_t ticks_at_start;
+
+/* the time the consumer needed, as of the end of the previous fill, to reach the chunk after it,
+ and when that was, which catch a stall between fills of a lap or more of the ring, which the
+ position alone cannot tell from no time at all */
+static uint64_t cushion_ticks;
+static uint32_t ticks_at_end;
+static int cushion_valid, lapped;
+
+static size_t headroom(const size_t ichunk) {
+    /* samples until the consumer reaches the start of the chunk being filled. if it is already
+     inside that chunk, this is more than the rest of the ring */
+    const size_t ring = chunk_count * samples_per_chunk;
+    return (ichunk % chunk_count * samples_per_chunk + ring - audio_out_position()) % ring;
+}
+
+static uint64_t samples_to_ticks(const size_t samples) {
+    return (uint64_t)samples * TOP * ticks_per_second() / SYS_CLOCK_HZ;
+}
+
+void underrun_fill_start(const size_t ichunk) {
+    ticks_at_start = ticks();
+    headroom_at_start = headroom(ichunk);
+    lapped = cushion_valid && ticks_at_start - ticks_at_end >= cushion_ticks;
+}
+
+int underrun_fill_end(const size_t ichunk) {
+    /* the consumer has not started yet while all but the last chunk are being filled */
+    if (ichunk + 2 <= chunk_count) return 0;
+
+    const size_t headroom_at_end = headroom(ichunk);
+    const uint32_t now = ticks();
+
+    const size_t most = (chunk_count - 1) * samples_per_chunk;
+
+    if (!lapped && headroom_at_start <= most && headroom_at_end <= most &&
+        headroom_at_end <= headroom_at_start && now - ticks_at_start < samples_to_ticks(headroom_at_start)) {
+        /* until the consumer reaches the next chunk, which if it is inside its slot, playing the
+         chunk a lap before it, is the rest of the ring */
+        const size_t cushion = headroom(ichunk + 1);
+        cushion_ticks = samples_to_ticks(cushion ? cushion : chunk_count * samples_per_chunk);
+        ticks_at_end = now;
+        cushion_valid = 1;
+        return 0;
+    }
+
+    /* after a resync, the next fill is only checked by position */
+    cushion_valid = 0;
+    underrun_stats.count++;
+    underrun_stats.last_chunk = ichunk;
+    return 1;
+}
+
+size_t underrun_resync(const size_t ichunk) {
+    /* chunk index, after this one, of the ring slot the consumer will play after the current one */
+    const size_t islot = (audio_out_position() / samples_per_chunk + 1) % chunk_count;
+    const size_t inext = ichunk + 1 + (islot + chunk_count - (ichunk + 1) % chunk_count) % chunk_count;
+
+    /* forget about any chunks the consumer finished while we were behind */
+    audio_out_clear();
+
+    if (!UNDERRUN_FADE)
+        return inext - 1;
+
+    /* ramp from wherever the consumer will leave off to the midpoint, in each channel */
+    for (size_t ichannel = 0; ichannel < AUDIO_OUT_CHANNELS; ichannel++) {
+        const float start = audio_out_chunk(inext - 1, ichannel)[(samples_per_chunk - 1) * SLICE_CHANNELS];
+        uint16_t * const dst = audio_out_chunk(inext, ichannel);
+        for (size_t ival = 0; ival < samples_per_chunk; ival++)
+            dst[ival * SLICE_CHANNELS] = start + (TOP / 2 - start) * (ival + 1) / samples_per_chunk + 0.5f;
+    }
+
+    return inext;
+}
@@ -0,0 +1,40 @@
+#ifndef UNDERRUN_H
+#define UNDERRUN_H
+
+/* detection of the consumer overtaking the producer in the chunk ring. the consumer position is
+ sampled at the start and end of each chunk fill: if the consumer was already inside the chunk
+ being filled at either point, or if the fill took longer than it took the consumer to reach the
+ chunk, then some of the chunk was played stale or half-written. as the position only tells
+ where the consumer is modulo the ring, a stall between fills, in the wait or in whatever else
+ the producer does there, of a whole lap or more would look like none at all, so the time from
+ the end of each fill to the start of the next is also checked against how long the consumer had
+ left then before reaching the next chunk */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* if nonzero, after an underrun the producer writes a fade to silence into the chunk the consumer
+ will play next, rather than leaving whatever stale audio was in it */
+#ifndef UNDERRUN_FADE
+#define UNDERRUN_FADE 1
+#endif
+
+struct underrun_stats {
+    size_t count;
+
+    /* chunk index at which the most recent underrun was detected, which unlike the tick count does
+     not wrap, so that its age can be told from the chunk being reported on */
+    size_t last_chunk;
+};
+
+extern struct underrun_stats underrun_stats;
+
+void underrun_fill_start(const size_t ichunk);
+
+/* returns nonzero if filling chunk ichunk underran */
+int underrun_fill_end(const size_t ichunk);
+
+/* skip ahead of the consumer after an underrun, returning the chunk index to continue after */
+size_t underrun_resync(const size_t ichunk);
+
+#endif
@@ -0,0 +1,94 @@
+#include "voices.h"
+
+#include <math.h>
+
+void voice_pool_init(struct voice_pool * pool, struct oscillator_bank * bank, const enum voice_steal steal) {
+    pool->bank = bank;
+    pool->steal = steal;
+    pool->sequence = 0;
+    for (size_t ivoice = 0; ivoice < bank->count; ivoice++)
+        pool->state[ivoice] = VOICE_FREE;
+}
+
+static int finished(const struct voice_pool * pool, const size_t ivoice) {
+    /* a release is over once its ramp, or its envelope, has landed on silence */
+    const struct oscillator_bank * const bank = pool->bank;
+    return VOICE_RELEASING == pool->state[ivoice] && (bank->envelope ? ENVELOPE_IDLE == bank->stage[ivoice] : !bank->glide_remaining[ivoice]);
+}
+
+size_t voice_find(const struct voice_pool * pool, const uint32_t note) {
+    for (size_t ivoice = 0; ivoice < pool->bank->count; ivoice++)
+        if (VOICE_FREE != pool->state[ivoice] && !finished(pool, ivoice) && pool->note[ivoice] == note)
+            return ivoice;
+    return pool->bank->count;
+}
+
+size_t voice_pool_sounding(const struct voice_pool * pool) {
+    size_t sounding = 0;
+    for (size_t ivoice = 0; ivoice < pool->bank->count; ivoice++)
+        sounding += VOICE_FREE != pool->state[ivoice] && !finished(pool, ivoice);
+    return sounding;
+}
+
+static int better_to_steal(const struct voice_pool * pool, const size_t ivoice, const size_t best) {
+    /* releasing voices before held ones, and then the oldest or the quietest */
+    const int releasing = VOICE_RELEASING == pool->state[ivoice], best_releasing = VOICE_RELEASING == pool->state[best];
+    if (releasing != best_releasing) return releasing;
+
+    if (VOICE_STEAL_QUIETEST == pool->steal)
+        return fabsf(pool->bank->amplitude[ivoice]) < fabsf(pool->bank->amplitude[best]);
+
+    /* in the order of note ons, which is robust to the sequence wrapping */
+    return (uint32_t)(pool->sequence - pool->started[ivoice]) > (uint32_t)(pool->sequence - pool->started[best]);
+}
+
+static size_t allocate(struct voice_pool * pool, const uint32_t note) {
+    /* in one pass: the voice already playing the note, else a free one, else the best to steal */
+    const size_t voices = pool->bank->count;
+    size_t unused = voices, best = voices;
+
+    for (size_t ivoice = 0; ivoice < voices; ivoice++) {
+        if (VOICE_FREE == pool->state[ivoice] || finished(pool, ivoice)) {
+            if (unused == voices) unused = ivoice;
+        }
+        else if (pool->note[ivoice] == note)
+            return ivoice;
+        else if (best == voices || better_to_steal(pool, ivoice, best))
+            best = ivoice;
+    }
+
+    return unused < voices ? unused : best;
+}
+
+size_t voice_note_on(struct voice_pool * pool, const uint32_t note, const float frequency, const float amplitude, const size_t attack) {
+    const size_t ivoice = allocate(pool, note);
+    if (ivoice >= pool->bank->count) return ivoice;
+
+    /* a free voice is silent, so it can jump to the new frequency, while a sounding one ramps its
+     frequency along with its amplitude, so that a steal or a retrigger does not click. with an
+     envelope, its attack starts from wherever the amplitude is, and the frequency ramps alongside */
+    struct oscillator_bank * const bank = pool->bank;
+    if (VOICE_FREE == pool->state[ivoice] || finished(pool, ivoice))
+        oscillator_bank_retune(bank, ivoice, frequency, 0.0f, 0, OSCILLATOR_RAMP);
+    oscillator_bank_retune(bank, ivoice, frequency, amplitude, bank->envelope ? bank->envelope->attack : attack, OSCILLATOR_RAMP);
+    if (bank->envelope) oscillator_bank_attack(bank, ivoice, amplitude);
+
+    pool->state[ivoice] = VOICE_HELD;
+    pool->note[ivoice] = note;
+    pool->started[ivoice] = pool->sequence++;
+    return ivoice;
+}
+
+void voice_note_off(struct voice_pool * pool, const uint32_t note, const size_t release) {
+    for (size_t ivoice = 0; ivoice < pool->bank->count; ivoice++)
+        if (VOICE_HELD == pool->state[ivoice] && pool->note[ivoice] == note) {
+            struct oscillator_bank * const bank = pool->bank;
+            if (bank->envelope)
+                oscillator_bank_release(bank, ivoice);
+            else {
+                const float frequency = bank->glide_remaining[ivoice] ? bank->frequency_target[ivoice] : bank->frequency[ivoice];
+                oscillator_bank_retune(bank, ivoice, frequency, 0.0f, release, OSCILLATOR_RAMP);
+            }
+            pool->state[ivoice] = VOICE_RELEASING;
+        }
+}
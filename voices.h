@@ -0,0 +1,61 @@
+#ifndef VOICES_H
+#define VOICES_H
+
+/* polyphonic voice allocation over the voices of a bank of phasors, which is a fixed pool, as the
+ bank is statically sized, so there is no allocation at run time. a note on takes a free voice, or
+ one whose release has finished, or failing that steals one, preferring voices which are releasing
+ over those which are held, and among those, the oldest or the quietest. a note off ramps the
+ voice down over its release, after which it is free again. every operation is one pass over the
+ pool at most, so the cost of a note is bounded by the size of the pool, whatever is playing */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "oscillators.h"
+
+enum voice_steal {
+    VOICE_STEAL_OLDEST,
+    VOICE_STEAL_QUIETEST,
+};
+
+#ifndef VOICE_STEAL
+#define VOICE_STEAL VOICE_STEAL_OLDEST
+#endif
+
+enum voice_state {
+    VOICE_FREE,
+    VOICE_HELD,
+    VOICE_RELEASING,
+};
+
+struct voice_pool {
+    struct oscillator_bank * bank;
+    enum voice_steal steal;
+
+    /* counts note ons, to tell which voice is oldest */
+    uint32_t sequence;
+
+    /* per voice of the bank, the note it plays, and when it started */
+    enum voice_state state[OSCILLATOR_BANK_VOICES];
+    uint32_t note[OSCILLATOR_BANK_VOICES], started[OSCILLATOR_BANK_VOICES];
+};
+
+/* the voices of the bank are the pool, and should already have been added, silent */
+void voice_pool_init(struct voice_pool * pool, struct oscillator_bank * bank, const enum voice_steal steal);
+
+/* starts a note, identified by any number, ramping its amplitude up over attack samples, or with
+ the attack of the envelope of the bank if it has one, and returns the voice playing it. a note which is already sounding is retriggered on the same voice.
+ a stolen voice glides to the new note from wherever it was, without a click, but is cut short */
+size_t voice_note_on(struct voice_pool * pool, const uint32_t note, const float frequency, const float amplitude, const size_t attack);
+
+/* releases a held note, ramping its amplitude down to 0 over release samples, or with the release
+ of the envelope of the bank if it has one */
+void voice_note_off(struct voice_pool * pool, const uint32_t note, const size_t release);
+
+/* the voice playing a note, held or releasing, or the size of the bank if none */
+size_t voice_find(const struct voice_pool * pool, const uint32_t note);
+
+/* voices which are held, or still releasing */
+size_t voice_pool_sounding(const struct voice_pool * pool);
+
+#endif
@@ -0,0 +1,123 @@
+#include "wavetable.h"
+
+#include <math.h>
+
+static float saw(const unsigned harmonic) {
+    /* rising from 0 at the start of each cycle, and from -1 to 0 in its second half */
+    return (harmonic % 2 ? 2.0f : -2.0f) / (float)M_PI / harmonic;
+}
+
+static float square(const unsigned harmonic) {
+    return harmonic % 2 ? 4.0f / (float)M_PI / harmonic : 0.0f;
+}
+
+static float triangle(const unsigned harmonic) {
+    return harmonic % 2 ? (harmonic % 4 == 1 ? 8.0f : -8.0f) / (float)(M_PI * M_PI) / ((float)harmonic * harmonic) : 0.0f;
+}
+
+static float sine(const unsigned harmonic) {
+    return 1 == harmonic ? 1.0f : 0.0f;
+}
+
+wavetable_harmonic waveform_harmonic(const enum waveform waveform) {
+    switch (waveform) {
+        case WAVEFORM_SAW: return saw;
+        case WAVEFORM_SQUARE: return square;
+        case WAVEFORM_TRIANGLE: return triangle;
+        default: return sine;
+    }
+}
+
+size_t wavetable_footprint(void) {
+    return WAVETABLE_ENTRIES * sizeof(int16_t);
+}
+
+void wavetable_init(struct wavetable * wavetable, const wavetable_harmonic harmonic) {
+    static float sum[WAVETABLE_TABLE_ENTRIES(0)];
+    float peak = 0.0f;
+
+    /* twice over, the first time only to find the peak over all tables */
+    for (int pass = 0; pass < 2; pass++) {
+        int16_t * entries = wavetable->entries;
+
+        for (unsigned octave = 0; octave < WAVETABLE_OCTAVES; octave++) {
+            const unsigned harmonics = 1U << (WAVETABLE_HARMONICS_BITS - octave), bits = WAVETABLE_TABLE_BITS(octave);
+            const size_t size = (size_t)1 << bits;
+
+            for (size_t i = 0; i <= size; i++)
+                sum[i] = 0.0f;
+
+            /* each harmonic by rotating a phasor, rather than calling sin() for every entry, which
+             would take seconds at boot for 512 harmonics of 2048 entries. over one cycle the
+             rounding errors stay far below the 16 bits of the entries */
+            for (unsigned k = 1; k <= harmonics; k++) {
+                const float amplitude = harmonic(k);
+                if (!amplitude) continue;
+
+                const float advance_re = cos(2.0 * M_PI * k / size), advance_im = sin(2.0 * M_PI * k / size);
+                float re = 1.0f, im = 0.0f;
+                for (size_t i = 0; i <= size; i++) {
+                    sum[i] += amplitude * im;
+                    const float next_re = re * advance_re - im * advance_im;
+                    im = re * advance_im + im * advance_re;
+                    re = next_re;
+                }
+            }
+
+            for (size_t i = 0; i <= size; i++)
+                if (!pass && fabsf(sum[i]) > peak) peak = fabsf(sum[i]);
+                else if (pass) entries[i] = lrintf(sum[i] * 32767.0f / peak);
+
+            wavetable->bits[octave] = bits;
+            wavetable->table[octave] = entries;
+            entries += size + 1;
+        }
+    }
+}
+
+void wavetable_bank_init(struct wavetable_bank * bank, const struct wavetable * wavetable) {
+    bank->wavetable = wavetable;
+    bank->count = 0;
+}
+
+unsigned wavetable_octave(const uint32_t increment) {
+    /* the table of each octave holds 2^(9 - octave) harmonics, all below nyquist as long as the
+     increment times that is at most 2^31, so the octave is log2 of the increment less 22, rounded up */
+    if (increment <= 1) return 0;
+    const int octave = 32 - __builtin_clz(increment - 1) - (31 - WAVETABLE_HARMONICS_BITS);
+    return octave < 0 ? 0 : octave >= WAVETABLE_OCTAVES ? WAVETABLE_OCTAVES - 1 : (unsigned)octave;
+}
+
+size_t wavetable_bank_add(struct wavetable_bank * bank, const double frequency, const float amplitude) {
+    if (bank->count >= WAVETABLE_BANK_MAX) return WAVETABLE_BANK_MAX;
+
+    const size_t ivoice = bank->count++;
+    bank->phase[ivoice] = 0;
+    bank->increment[ivoice] = (uint32_t)(int64_t)llround(frequency * 4294967296.0);
+    bank->amplitude[ivoice] = amplitude;
+    bank->octave[ivoice] = wavetable_octave(bank->increment[ivoice]);
+    return ivoice;
+}
+
+void wavetable_bank_render(struct wavetable_bank * bank, float * re, const size_t count) {
+    for (size_t ival = 0; ival < count; ival++)
+        re[ival] = 0.0f;
+
+    /* one voice at a time, so that its table, shift and scale stay in registers */
+    for (size_t ivoice = 0; ivoice < bank->count; ivoice++) {
+        const unsigned fraction_bits = 32 - bank->wavetable->bits[bank->octave[ivoice]];
+        const int16_t * const table = bank->wavetable->table[bank->octave[ivoice]];
+        const uint32_t increment = bank->increment[ivoice], fraction_mask = (1U << fraction_bits) - 1;
+        const float amplitude = bank->amplitude[ivoice] * (1.0f / 32767.0f), fraction_scale = 1.0f / (fraction_mask + 1.0f);
+        uint32_t phase = bank->phase[ivoice];
+
+        for (size_t ival = 0; ival < count; ival++) {
+            const uint32_t index = phase >> fraction_bits;
+            const float fraction = (phase & fraction_mask) * fraction_scale;
+            re[ival] += (table[index] + fraction * (table[index + 1] - table[index])) * amplitude;
+            phase += increment;
+        }
+
+        bank->phase[ivoice] = phase;
+    }
+}
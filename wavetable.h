@@ -0,0 +1,93 @@
+#ifndef WAVETABLE_H
+#define WAVETABLE_H
+
+/* band-limited wavetables: each waveform is stored as one table per octave of fundamental, each
+ holding only the harmonics which stay below nyquist anywhere in its octave, so that any waveform
+ can be played alias-free by a phase accumulator, as in dds.h, with linear interpolation, picking
+ the table by the phase increment, without summing harmonics per sample.
+
+ the table for the lowest octave holds 512 harmonics, which is complete for fundamentals above
+ about 46 Hz at 46875 Hz, and each octave up holds half as many, down to a pure sine. the images
+ of linear interpolation fold back as aliases at a level which falls with the size of the table,
+ so each has at least four entries per cycle of its highest harmonic, and at least 1024 in all.
+ as 16-bit integers, that comes to 22.5 kB per waveform, built at boot into sram. a minimum of
+ 256 entries would fit the 16 kB xip cache, were the tables generated into flash, with aliases
+ about 12 dB higher at low fundamentals, and 2048 would take 40 kB for about 13 dB lower */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define WAVETABLE_OCTAVES 10
+
+/* log2 of the harmonics in the lowest octave's table, and of the fewest entries in any table */
+#define WAVETABLE_HARMONICS_BITS (WAVETABLE_OCTAVES - 1)
+#ifndef WAVETABLE_MIN_BITS
+#define WAVETABLE_MIN_BITS 10
+#endif
+
+/* log2 of the entries per cycle of the highest harmonic in each table */
+#ifndef WAVETABLE_OVERSAMPLING_BITS
+#define WAVETABLE_OVERSAMPLING_BITS 2
+#endif
+
+/* entries of the table of each octave, with one extra so that interpolation never needs to wrap */
+#define WAVETABLE_TABLE_BITS(octave) (WAVETABLE_HARMONICS_BITS - (octave) + WAVETABLE_OVERSAMPLING_BITS > WAVETABLE_MIN_BITS ? \
+    WAVETABLE_HARMONICS_BITS - (octave) + WAVETABLE_OVERSAMPLING_BITS : WAVETABLE_MIN_BITS)
+#define WAVETABLE_TABLE_ENTRIES(octave) ((1 << WAVETABLE_TABLE_BITS(octave)) + 1)
+
+#define WAVETABLE_ENTRIES (WAVETABLE_TABLE_ENTRIES(0) + WAVETABLE_TABLE_ENTRIES(1) + WAVETABLE_TABLE_ENTRIES(2) + \
+    WAVETABLE_TABLE_ENTRIES(3) + WAVETABLE_TABLE_ENTRIES(4) + WAVETABLE_TABLE_ENTRIES(5) + WAVETABLE_TABLE_ENTRIES(6) + \
+    WAVETABLE_TABLE_ENTRIES(7) + WAVETABLE_TABLE_ENTRIES(8) + WAVETABLE_TABLE_ENTRIES(9))
+_Static_assert(10 == WAVETABLE_OCTAVES, "WAVETABLE_ENTRIES sums ten octaves");
+
+enum waveform {
+    WAVEFORM_SINE,
+    WAVEFORM_SAW,
+    WAVEFORM_SQUARE,
+    WAVEFORM_TRIANGLE,
+};
+
+struct wavetable {
+    /* log2 of the entries of each table, and where it starts */
+    unsigned bits[WAVETABLE_OCTAVES];
+    const int16_t * table[WAVETABLE_OCTAVES];
+
+    int16_t entries[WAVETABLE_ENTRIES];
+};
+
+/* the amplitude of the sine of each harmonic, from 1, for any timbre */
+typedef float (* wavetable_harmonic)(const unsigned harmonic);
+
+/* builds the tables from the given harmonic amplitudes, all scaled by the same factor so that the
+ peak of any table is full scale */
+void wavetable_init(struct wavetable * wavetable, const wavetable_harmonic harmonic);
+
+/* the harmonic amplitudes of the classic waveforms */
+wavetable_harmonic waveform_harmonic(const enum waveform waveform);
+
+/* bytes of table per waveform, which is what it costs in sram or the xip cache */
+size_t wavetable_footprint(void);
+
+#define WAVETABLE_BANK_MAX 128
+
+struct wavetable_bank {
+    const struct wavetable * wavetable;
+    size_t count;
+    uint32_t phase[WAVETABLE_BANK_MAX], increment[WAVETABLE_BANK_MAX];
+    float amplitude[WAVETABLE_BANK_MAX];
+
+    /* the octave of each voice, picked by its increment */
+    unsigned octave[WAVETABLE_BANK_MAX];
+};
+
+void wavetable_bank_init(struct wavetable_bank * bank, const struct wavetable * wavetable);
+
+/* as for dds_bank_add(), but the phase starts at 0. returns the index of the new voice, or WAVETABLE_BANK_MAX if full */
+size_t wavetable_bank_add(struct wavetable_bank * bank, const double frequency, const float amplitude);
+
+/* the octave whose table has no harmonic above nyquist for the given increment */
+unsigned wavetable_octave(const uint32_t increment);
+
+void wavetable_bank_render(struct wavetable_bank * bank, float * re, const size_t count);
+
+#endif